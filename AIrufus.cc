@@ -1,10 +1,9 @@
 #include "Player.hh"
 
-#include <queue>
-#include <map>
 #include <array>
 #include <functional>
 #include <cmath>
+#include <ctime>
 
 #define INT_INFINITY 99999999
 
@@ -75,6 +74,29 @@ struct PLAYER_NAME : public Player {
   const double ADJACENT_ENEMY_EVALUATION;
   const double ADJACENT_ALLIED_EVALUATION;
   const bool GLOBAL_OWNED_CITIES;
+  const int CHEAP_BFS_RANGE; // range of the BFS that every unit gets, whatever the time left
+  const int NEAR_ENEMY_DISTANCE; // units with enemies this close are deepened before others
+  const double DEFAULT_ROUND_TIME; // cpu seconds per round while status() tells nothing (it is 0 outside the server)
+  // status() is the cpu time of this player over its limit. The limit is estimated assuming that all of it is
+  // spent in play(): cpu time spent elsewhere only lowers the estimate, making the scheduler more cautious.
+  const double TARGET_STATUS; // fraction of the cpu time limit meant to be used by the end of the game
+  const double EMERGENCY_STATUS; // from here on, units are not even evaluated
+
+  // distance-decay tables: DISTANCE_TO_THE[k][d] == pow(d, k), for d up to LOCAL_BFS_RANGE + 1
+  const vector<vector<double>> DISTANCE_TO_THE;
+  static vector<vector<double>> distancePowers(const int maxDistance);
+
+  // BFS scratch space, reused by every localEvaluation (cells are indexed by i*cols() + j)
+  struct Appointment {
+    int index;
+    Cell content;
+  };
+  mutable vector<int> visitedStamp; // a cell is visited iff its stamp is currentStamp
+  mutable int currentStamp;
+  mutable vector<int> cellDistance;
+  mutable vector<DirectionBooleans> cellReachableFrom;
+  mutable vector<Appointment> scheduledAppointments; // ring buffer, its size is a power of 2
+  void prepareBFS(const int RANGE) const;
 
   // cell mask evaluation functions
   double MASK_EVALUATION_FUNCTION(const int distance, const Unit & myUnit) const;
@@ -102,30 +124,97 @@ struct PLAYER_NAME : public Player {
 
   PLAYER_NAME();
 
-  Pos closestCityOrPathEstimation(const Pos & source) const;
-  DirectionBooleans shortestPathDirections(const Pos & source, const Pos & destination) const;
+  // distances to the closest target (city or path cell not owned, or any if GLOBAL_OWNED_CITIES),
+  // computed by one multi-source BFS per round
+  mutable vector<int> targetDistance;
+  mutable int targetDistanceRound;
+  void computeTargetDistances() const;
+  DirectionBooleans closestTargetDirections(const Unit & myUnit) const;
   
   DirectionEvaluation localEvaluation(const Unit & myUnit, const int RANGE) const;
   DirectionEvaluation globalEvaluation(const Unit & myUnit) const;
   Dir chosenDirection(const DirectionEvaluation & evaluation);
+
+  // time management
+  double spentTime; // cpu seconds spent in play() so far
+  double roundTimeBudget() const;
+  int unitPriority(const Unit & myUnit) const;
   void play() override;
 };
 
+// cpu time of this thread, in seconds: unlike wall time, it is what status() measures, even on a loaded machine
+double cpuSeconds() {
+  timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// anytime: every unit gets a cheap evaluation, then units are deepened by priority while there is time left
 void PLAYER_NAME::play() {
-  const double cpuStatus = status(me());
-  for(const int unitID : my_units(me())) {
-    const Unit u = unit(unitID);
-    const DirectionEvaluation evaluation = [&] {
-      if(cpuStatus < 0.5 or (cpuStatus < 0.8 and round() > 175))
-        return localEvaluation(u, LOCAL_BFS_RANGE) + globalEvaluation(u);
-      else if(cpuStatus < 0.9)
-        return localEvaluation(u, 2);
-      else
-        return DirectionEvaluation { NULL_EVALUATION };
-    }();
-    const Dir direction = chosenDirection(evaluation);
-    move(unitID, direction);
+  const double roundStart = cpuSeconds();
+  const double budget = roundTimeBudget();
+  const bool emergency = status(me()) >= EMERGENCY_STATUS;
+
+  const vector<int> unitIDs = my_units(me());
+  vector<Unit> units;
+  for(const int unitID : unitIDs) units.push_back(unit(unitID));
+
+  // best direction so far of every unit, kept if there is no time to deepen it
+  vector<Dir> direction;
+  for(const Unit & u : units)
+    direction.push_back(chosenDirection(emergency
+      ? DirectionEvaluation { NULL_EVALUATION }
+      : localEvaluation(u, CHEAP_BFS_RANGE)));
+
+  vector<int> order(units.size());
+  for(int k = 0; k < int(order.size()); k++) order[k] = k;
+  if(not emergency) {
+    vector<int> priority;
+    for(const Unit & u : units) priority.push_back(unitPriority(u));
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return priority[a] < priority[b]; });
+    computeTargetDistances(); // shared by all global evaluations, so not part of the slowest one
+
+    // stop before the next evaluation, as slow as the slowest one so far, would surpass the budget
+    double slowestEvaluation = 0;
+    for(const int k : order) {
+      if(cpuSeconds() - roundStart + slowestEvaluation > budget) break;
+      const double evaluationStart = cpuSeconds();
+      direction[k] = chosenDirection(localEvaluation(units[k], LOCAL_BFS_RANGE) + globalEvaluation(units[k]));
+      slowestEvaluation = max(slowestEvaluation, cpuSeconds() - evaluationStart);
+    }
   }
+
+  for(int k = 0; k < int(unitIDs.size()); k++) move(unitIDs[k], direction[k]);
+  spentTime += cpuSeconds() - roundStart;
+}
+
+// cpu seconds for this round: the time left until TARGET_STATUS, shared among the rounds left.
+// The whole time limit is estimated from status() and the cpu time spent in play() so far.
+double PLAYER_NAME::roundTimeBudget() const {
+  const double cpuStatus = status(me());
+  if(cpuStatus <= 0 or spentTime <= 0) return DEFAULT_ROUND_TIME;
+  const double timeLimit = spentTime / cpuStatus;
+  const int roundsLeft = max(1, nb_rounds() - round());
+  return max(0.0, (TARGET_STATUS*timeLimit - spentTime) / roundsLeft);
+}
+
+// lower is more urgent: infected, contested (on a city or path cell not owned), near enemies, others
+int PLAYER_NAME::unitPriority(const Unit & u) const {
+  if(u.damage > 0) return 0;
+
+  const Cell c = cell(u.pos);
+  if((c.type == CellType::CITY and city_owner(c.city_id) != me())
+     or (c.type == CellType::PATH and path_owner(c.path_id) != me())) return 1;
+
+  for(int di = -NEAR_ENEMY_DISTANCE; di <= NEAR_ENEMY_DISTANCE; di++)
+    for(int dj = abs(di) - NEAR_ENEMY_DISTANCE; dj <= NEAR_ENEMY_DISTANCE - abs(di); dj++) {
+      const Pos p = u.pos + Pos(di, dj);
+      if(pos_ok(p)) {
+        const int unitID = cell(p).unit_id;
+        if(unitID != -1 and unit(unitID).player != me()) return 2;
+      }
+    }
+  return 3;
 }
 
 // BFS search
@@ -135,21 +224,24 @@ PLAYER_NAME::DirectionEvaluation PLAYER_NAME::localEvaluation(const Unit & u, co
   int foundAlliesCounter = 0;
   int foundEnemiesCounter = 0;
   
-  struct Ticket {
-    int distance;
-    DirectionBooleans reachableFrom;
+  prepareBFS(RANGE);
+  const int COLS = cols();
+  const int MASK = scheduledAppointments.size() - 1;
+  unsigned int first = 0, last = 0; // appointments in [first, last) are scheduled
+
+  auto visit = [&](const int index, const int distance, const DirectionBooleans & reachableFrom) {
+    visitedStamp[index] = currentStamp;
+    cellDistance[index] = distance;
+    cellReachableFrom[index] = reachableFrom;
   };
 
-  map<Pos, Ticket> visited;
-  queue<map<Pos, Ticket>::const_iterator> scheduledAppointments;
-  // insert to map: source and cells arround it (if aren't walls)
-  visited[u.pos] = { 0, DirectionBooleans(false) };
+  // visit source and cells arround it (if aren't walls)
+  visit(u.pos.i*COLS + u.pos.j, 0, DirectionBooleans(false));
   for(const Dir direction : POSSIBLE_DIRECTIONS()) {
     const Pos position = u.pos + direction;
-    const auto foo = visited.insert({ position, { 1, DirectionBooleans(direction)}}); // would use structured bindings in c++17 :/
-    const auto & iteratorPosition = foo.first;
-    const bool & beenInserted = foo.second;
-    assert(beenInserted); // check it was properly inserted
+    const int index = position.i*COLS + position.j;
+    assert(visitedStamp[index] != currentStamp); // check it was not visited
+    visit(index, 1, DirectionBooleans(direction));
     // give ticket it not wall or contains enemy
     const Cell c = cell(position);
     const int unitID = c.unit_id;
@@ -163,37 +255,37 @@ PLAYER_NAME::DirectionEvaluation PLAYER_NAME::localEvaluation(const Unit & u, co
         ? ADJACENT_ALLIED_EVALUATION
         : ADJACENT_COMBAT_EVALUATION(ADJACENT_ENEMY_EVALUATION, u, foundUnit);
     }
-    else scheduledAppointments.push(iteratorPosition);
+    else scheduledAppointments[last++ & MASK] = { index, c };
   }
 
-  while(not scheduledAppointments.empty()) {
-    auto currentlyVisited = scheduledAppointments.front(); scheduledAppointments.pop();
-    const Pos & currentPosition = currentlyVisited->first;
-    const Ticket & currentTicket = currentlyVisited->second;
+  while(first != last) {
+    const Appointment & currentlyVisited = scheduledAppointments[first++ & MASK];
+    const int currentIndex = currentlyVisited.index;
+    const int currentDistance = cellDistance[currentIndex];
 
-    if(currentTicket.distance > RANGE) return evaluation; // before evaluating the current cell, which is the first to surpass the max range
+    if(currentDistance > RANGE) return evaluation; // before evaluating the current cell, which is the first to surpass the max range
 
     // visit current cell
-    evaluation += cellEvaluation(currentTicket.distance, cell(currentPosition), u, currentTicket.reachableFrom, foundAlliesCounter, foundEnemiesCounter);
+    const DirectionBooleans & currentReachableFrom = cellReachableFrom[currentIndex];
+    evaluation += cellEvaluation(currentDistance, currentlyVisited.content, u, currentReachableFrom, foundAlliesCounter, foundEnemiesCounter);
 
     // hand tickets to its neighbours
+    const Pos currentPosition(currentIndex / COLS, currentIndex % COLS);
     for(const Dir currentDirection : POSSIBLE_DIRECTIONS()) {
       const Pos neighbourPosition = currentPosition + currentDirection;
-      // if visited
-      const auto foundNeighbourPosition = visited.find(neighbourPosition);
-      if(foundNeighbourPosition != visited.end()) {
-        foundNeighbourPosition->second.reachableFrom += currentTicket.reachableFrom;
+      const int neighbourIndex = neighbourPosition.i*COLS + neighbourPosition.j;
+      // if visited (walls are visited too, but never scheduled)
+      if(visitedStamp[neighbourIndex] == currentStamp) {
+        cellReachableFrom[neighbourIndex] += currentReachableFrom;
       }
       // if not visited
       else {
         const Cell c = cell(neighbourPosition);
+        visit(neighbourIndex, currentDistance + 1, currentReachableFrom);
         // if not wall, ask ticket
-          if(c.type != CellType::WALL) {
-          const int distance = currentTicket.distance + 1;
-          const DirectionBooleans & reachableFrom = currentTicket.reachableFrom;
-          const auto foo = visited.insert({ neighbourPosition, { distance, reachableFrom }});
-          const auto insertedNeighbourPosition = foo.first;
-          scheduledAppointments.push(insertedNeighbourPosition);
+        if(c.type != CellType::WALL) {
+          assert(last - first < scheduledAppointments.size());
+          scheduledAppointments[last++ & MASK] = { neighbourIndex, c };
         }
       }
     }
@@ -201,6 +293,29 @@ PLAYER_NAME::DirectionEvaluation PLAYER_NAME::localEvaluation(const Unit & u, co
   return evaluation;
 }
 
+// sizes the scratch space of the BFS for the board and the range, and forgets visited cells
+void PLAYER_NAME::prepareBFS(const int RANGE) const {
+  assert(RANGE + 1 < int(DISTANCE_TO_THE[0].size())); // distances evaluated are in the decay tables
+  const int cells = rows()*cols();
+  if(int(visitedStamp.size()) != cells) {
+    visitedStamp.assign(cells, 0);
+    cellDistance.assign(cells, 0);
+    cellReachableFrom.assign(cells, DirectionBooleans(false));
+    currentStamp = 0;
+  }
+  // cells up to distance RANGE + 1 are scheduled, each at most once
+  const long long reachable = min<long long>(cells, 2LL*(RANGE + 1)*(RANGE + 2) + 1);
+  size_t size = 1;
+  while((long long)size < reachable) size *= 2;
+  if(scheduledAppointments.size() < size) scheduledAppointments.resize(size);
+
+  if(currentStamp == INT_MAX) {
+    fill(visitedStamp.begin(), visitedStamp.end(), 0);
+    currentStamp = 0;
+  }
+  currentStamp++;
+}
+
 
 // returns the maximum direction (if positive) or NONE (if non-positive)
 Dir PLAYER_NAME::chosenDirection(const DirectionEvaluation & evaluation) {
@@ -236,11 +351,12 @@ PLAYER_NAME::DirectionEvaluation PLAYER_NAME::cellEvaluation(const int distance,
 
   const double cellEvaluation = cellTypeEvaluation + cellUnitEvaluation + cellMaskEvaluation + cellVirusEvaluation;
 
-  return DirectionEvaluation([&](const Dir direction) {
-    return reachableFrom[direction]
+  DirectionEvaluation evaluation;
+  for(const Dir direction : POSSIBLE_DIRECTIONS())
+    evaluation[direction] = reachableFrom[direction]
       ? cellEvaluation
       : NULL_EVALUATION;
-  });
+  return evaluation;
 }
 
 double PLAYER_NAME::LOCAL_CELLTYPE_EVALUATION_FUNCTION(const int distance, const Unit & myUnit, const CellType & cellType) const {
@@ -260,7 +376,7 @@ double PLAYER_NAME::MASK_EVALUATION_FUNCTION(const int distance, const Unit & my
   const double maskEvaluation = myUnit.damage > 0
     ? MASK_EVALUATION_IF_INFECTED
     : MASK_EVALUATION;
-  return maskEvaluation/pow(distance,3);
+  return maskEvaluation/DISTANCE_TO_THE[3][distance];
 }
 
 // cell virus evaluation functions
@@ -269,7 +385,7 @@ double PLAYER_NAME::VIRUS_EVALUATION_FUNCTION(const int distance, const int viru
   const double virusEvaluation = myUnit.damage > 0
     ? VIRUS_EVALUATION_IF_INFECTED
     : VIRUS_EVALUATION * virus; // maybe squared ?
-  return virusEvaluation/pow(distance,3);
+  return virusEvaluation/DISTANCE_TO_THE[3][distance];
 }
 
 double PLAYER_NAME::LOCAL_UNIT_EVALUATION_FUNCTION(const int distance, const Unit & myUnit, const Unit & otherUnit, int & foundAlliesCounter, int & foundEnemiesCounter) const {
@@ -297,7 +413,7 @@ double PLAYER_NAME::ENEMY_UNIT_EVALUATION_FUNCTION(const int distance, const Uni
   }();
   const int healthDifference = myUnit.health - enemyUnit.health;
   //return (100 + healthDifference)*enemyEvaluation*pow(foundAlliesCounter,5)/pow(distance,6)/pow(foundEnemiesCounter, 5); // allied/enemies version
-  return (100 + healthDifference)*enemyEvaluation*pow(foundAlliesCounter - foundEnemiesCounter,5)/pow(distance,6); // allied - enemies version 
+  return (100 + healthDifference)*enemyEvaluation*pow(foundAlliesCounter - foundEnemiesCounter,5)/DISTANCE_TO_THE[6][distance]; // allied - enemies version 
 }
 
 double PLAYER_NAME::ADJACENT_COMBAT_EVALUATION(const double EVALUATION_CONSTANT, const Unit & myUnit, const Unit & enemyUnit) const {
@@ -325,7 +441,7 @@ double PLAYER_NAME::LOCAL_CITY_EVALUATION_FUNCTION(const int distance, const Uni
   const double cityEvaluation = myUnit.damage > 0
     ? LOCAL_CITY_EVALUATION_IF_INFECTED
     : LOCAL_CITY_EVALUATION;
-  return cityEvaluation/pow(distance,2);
+  return cityEvaluation/DISTANCE_TO_THE[2][distance];
 }
 
 double PLAYER_NAME::LOCAL_PATH_EVALUATION_FUNCTION(const int distance, const Unit & myUnit) const {
@@ -333,7 +449,7 @@ double PLAYER_NAME::LOCAL_PATH_EVALUATION_FUNCTION(const int distance, const Uni
   const double pathEvaluation = myUnit.damage > 0
     ? LOCAL_PATH_EVALUATION_IF_INFECTED
     : LOCAL_PATH_EVALUATION;
-  return pathEvaluation/pow(distance,2);
+  return pathEvaluation/DISTANCE_TO_THE[2][distance];
 }
 
 double PLAYER_NAME::LOCAL_WALL_EVALUATION_FUNCTION(const int distance, const Unit & myUnit) const {
@@ -341,117 +457,71 @@ double PLAYER_NAME::LOCAL_WALL_EVALUATION_FUNCTION(const int distance, const Uni
   const double wallEvaluation = myUnit.damage > 0
     ? LOCAL_WALL_EVALUATION_IF_INFECTED
     : LOCAL_WALL_EVALUATION;
-  return wallEvaluation/pow(distance,3);
-}
-
-int manhattanDistance(const Pos & a, const Pos & b) {
-  return abs(a.i - b.i) + abs(a.j - b.j);
+  return wallEvaluation/DISTANCE_TO_THE[3][distance];
 }
 
-Pos PLAYER_NAME::closestCityOrPathEstimation(const Pos & source) const {
-  Pos closestPosition = { -1, -1 };
-  int shortestDistance = INT_INFINITY;
-
-  auto updateClosest = [&](int numberOfIDs, std::function<int(int)> ownerID, std::function<vector<Pos>(int)> positions) {
-    for(int id = 0; id < numberOfIDs; id++) {
-      if(ownerID(id) != me() or GLOBAL_OWNED_CITIES) {
-        for(const Pos candidatePosition : positions(id)) {
-          const int distanceCandidate = manhattanDistance(source, candidatePosition);
-          if(distanceCandidate < shortestDistance) {
-            shortestDistance = distanceCandidate;
-            closestPosition = candidatePosition;
-          }
+// multi-source BFS from every target, through non-wall cells (units move, so they don't block)
+void PLAYER_NAME::computeTargetDistances() const {
+  const int COLS = cols();
+  targetDistance.assign(rows()*COLS, INT_INFINITY);
+  vector<int> scheduledAppointments;
+  scheduledAppointments.reserve(rows()*COLS);
+
+  auto addTargets = [&](const int owner, const vector<Pos> & positions) {
+    if(owner != me() or GLOBAL_OWNED_CITIES) {
+      for(const Pos & p : positions) {
+        const int index = p.i*COLS + p.j;
+        if(targetDistance[index] != 0) {
+          targetDistance[index] = 0;
+          scheduledAppointments.push_back(index);
         }
       }
     }
   };
-
-  updateClosest(nb_cities(), [&](int id) { return city_owner(id); }, [&](int cityID) { return city(cityID); });
-  updateClosest(nb_paths(), [&](int id) { return path_owner(id); }, [&](int pathID) { return path(pathID).second; });
-
-  return closestPosition;
+  for(int id = 0; id < nb_cities(); id++) addTargets(city_owner(id), city(id));
+  for(int id = 0; id < nb_paths(); id++) addTargets(path_owner(id), path(id).second);
+
+  for(size_t first = 0; first < scheduledAppointments.size(); first++) {
+    const int currentIndex = scheduledAppointments[first];
+    const Pos currentPosition(currentIndex / COLS, currentIndex % COLS);
+    for(const Dir direction : POSSIBLE_DIRECTIONS()) {
+      const Pos neighbourPosition = currentPosition + direction;
+      const int neighbourIndex = neighbourPosition.i*COLS + neighbourPosition.j;
+      if(targetDistance[neighbourIndex] == INT_INFINITY and cell(neighbourPosition).type != CellType::WALL) {
+        targetDistance[neighbourIndex] = targetDistance[currentIndex] + 1;
+        scheduledAppointments.push_back(neighbourIndex);
+      }
+    }
+  }
+  targetDistanceRound = round();
 }
 
-// implements A* algorithm, with manhattan distance to destination as heuristic
-PLAYER_NAME::DirectionBooleans PLAYER_NAME::shortestPathDirections(const Pos & source, const Pos & destination) const {
-  struct Ticket {
-    int localGoal;
-    int globalGoal;
-    DirectionBooleans reachableFrom;
-    bool visited;
-  };
-
-  using PosTicket = map<Pos, Ticket>::iterator;
+// directions to the free adjacent cells closest to a target (none if already on a target or if no target is reachable)
+PLAYER_NAME::DirectionBooleans PLAYER_NAME::closestTargetDirections(const Unit & myUnit) const {
+  if(targetDistanceRound != round()) computeTargetDistances();
+  const int COLS = cols();
+  DirectionBooleans directions(false);
+  const int distanceHere = targetDistance[myUnit.pos.i*COLS + myUnit.pos.j];
+  if(distanceHere == 0 or distanceHere == INT_INFINITY) return directions;
 
-  struct PosTicketCompare {
-      bool operator()(const PosTicket & a, const PosTicket & b) { return a->second.globalGoal > b->second.globalGoal; };
-  };
-
-  map<Pos, Ticket> visited;
-  priority_queue<PosTicket, vector<PosTicket>, PosTicketCompare> scheduledAppointments;
-  // insert to map: source and cells arround it (if aren't walls)
-  visited[source] = { 0, manhattanDistance(source, destination), DirectionBooleans(false), true };
+  // walls are at infinite distance; adjacent units block, as they can't be walked through
+  array<int, 4> distance;
+  int shortestDistance = INT_INFINITY;
   for(const Dir direction : POSSIBLE_DIRECTIONS()) {
-    const Pos position = source + direction;
-    const auto foo = visited.insert({ position, { 1, 1 + manhattanDistance(position, destination), DirectionBooleans(direction), false}}); // changed me mind: C++ 17 strctured bindings *-*
-    const auto & iteratorPosition = foo.first;
-    const bool & beenInserted = foo.second;
-    assert(beenInserted); // check it was properly inserted
-    // give ticket if not wall or contains enemy
-    const Cell c = cell(position);
-    if(c.type != CellType::WALL and c.unit_id == -1) scheduledAppointments.push(iteratorPosition);
-  }
-
-  while(not scheduledAppointments.empty()) {
-    PosTicket currentlyVisited = scheduledAppointments.top(); scheduledAppointments.pop();
-    const Pos & currentPosition = currentlyVisited->first;
-    Ticket & currentTicket = currentlyVisited->second;
-    if(currentPosition == destination) return currentTicket.reachableFrom;
-    else if(not currentTicket.visited) { // if not visited
-      currentTicket.visited = true;
-
-      for(const Dir currentDirection : POSSIBLE_DIRECTIONS()) {
-        const Pos neighbourPosition = currentPosition + currentDirection;
-        if(cell(neighbourPosition).type == CellType::WALL) {
-          visited[neighbourPosition].visited = true; // to avoid searching later
-        }
-        else  { 
-          PosTicket neighbour = visited.find(neighbourPosition);
-          // not visited though already initialized (has been neighbour of some visited node)
-          // relax
-          if(neighbour != visited.end()) {
-            const int candidateLocal = currentTicket.localGoal + 1;
-            Ticket & neighbourTicket = neighbour->second;
-            if(candidateLocal < neighbourTicket.localGoal) {
-              neighbourTicket.localGoal = candidateLocal;
-              neighbourTicket.globalGoal = candidateLocal + manhattanDistance(neighbourPosition, destination);
-              neighbourTicket.reachableFrom = currentTicket.reachableFrom;
-            }
-            else if(candidateLocal == neighbourTicket.localGoal) {
-              neighbourTicket.reachableFrom += currentTicket.reachableFrom;
-            }
-            scheduledAppointments.push(neighbour);
-          }
-          else  { // not visited as neighbour
-            auto foo = visited.insert({ neighbourPosition, { currentTicket.localGoal + 1, currentTicket.localGoal + 1 + manhattanDistance(neighbourPosition, destination), currentTicket.reachableFrom, false }});
-            PosTicket & newNeighbour = foo.first;
-            const bool & beenInserted = foo.second;
-            assert(beenInserted);
-            scheduledAppointments.push(newNeighbour);
-          }
-        }
-      }
-    }
-    // else we ignore it and keep going
+    const Pos position = myUnit.pos + direction;
+    distance[direction] = cell(position).unit_id == -1
+      ? targetDistance[position.i*COLS + position.j]
+      : INT_INFINITY;
+    shortestDistance = min(shortestDistance, distance[direction]);
   }
-  return visited[destination].reachableFrom;
+  if(shortestDistance == INT_INFINITY) return directions;
+  for(const Dir direction : POSSIBLE_DIRECTIONS())
+    if(distance[direction] == shortestDistance) directions += DirectionBooleans(direction);
+  return directions;
 }
 
 PLAYER_NAME::DirectionEvaluation PLAYER_NAME::globalEvaluation(const Unit & myUnit) const {
-  const Pos estimatedClosestCityOrPath = closestCityOrPathEstimation(myUnit.pos);
-  const DirectionBooleans directionsToClosestCity = isNull(estimatedClosestCityOrPath)
-    ? DirectionBooleans(false)
-    : shortestPathDirections(myUnit.pos, estimatedClosestCityOrPath);
+  const DirectionBooleans directionsToClosestCity = closestTargetDirections(myUnit);
 
   return DirectionEvaluation([&](const Dir direction) {
     return directionsToClosestCity[direction]
@@ -486,9 +556,26 @@ PLAYER_NAME::PLAYER_NAME():
   ADJACENT_WALL_EVALUATION(-INFINITY),
   ADJACENT_ENEMY_EVALUATION(INFINITY),
   ADJACENT_ALLIED_EVALUATION(-INFINITY),
-  GLOBAL_OWNED_CITIES(false)
+  GLOBAL_OWNED_CITIES(false),
+  CHEAP_BFS_RANGE(2),
+  NEAR_ENEMY_DISTANCE(3),
+  DEFAULT_ROUND_TIME(0.02),
+  TARGET_STATUS(0.85),
+  EMERGENCY_STATUS(0.9),
+  DISTANCE_TO_THE(distancePowers(int(LOCAL_BFS_RANGE) + 1)),
+  currentStamp(0),
+  targetDistanceRound(-1),
+  spentTime(0)
 {}
 
+vector<vector<double>> PLAYER_NAME::distancePowers(const int maxDistance) {
+  vector<vector<double>> powers(7, vector<double>(maxDistance + 1));
+  for(int exponent = 0; exponent < int(powers.size()); exponent++)
+    for(int distance = 0; distance <= maxDistance; distance++)
+      powers[exponent][distance] = pow(distance, exponent);
+  return powers;
+}
+
 const vector<Dir> & PLAYER_NAME::POSSIBLE_DIRECTIONS() const {
   static vector<Dir> directions = { Dir::BOTTOM, Dir::RIGHT, Dir::TOP, Dir::LEFT };
   return directions;
@@ -506,13 +593,14 @@ PLAYER_NAME::DirectionEvaluation::DirectionEvaluation(function<double(const Dir)
 : evaluation({evaluationFunction(Dir::BOTTOM), evaluationFunction(Dir::RIGHT), evaluationFunction(Dir::TOP), evaluationFunction(Dir::LEFT)}) {}
 
 PLAYER_NAME::DirectionEvaluation PLAYER_NAME::DirectionEvaluation::operator+(const DirectionEvaluation & other) const {
-  return DirectionEvaluation([&](const Dir direction) {
-    return (*this)[direction] + other[direction];
-  });
+  DirectionEvaluation sum = *this;
+  sum += other;
+  return sum;
 }
 
 void PLAYER_NAME::DirectionEvaluation::operator+=(const DirectionEvaluation & other) {
-  *this = *this + other;
+  for(int index = 0; index < 4; index++)
+    evaluation[index] += other.evaluation[index];
 }
 
 double & PLAYER_NAME::DirectionEvaluation::operator[](const Dir & direction) {
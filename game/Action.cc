@@ -1,5 +1,9 @@
 #include "Action.hh"
 
+
+int Action::max_commands_ = Action::MAX_COMMANDS;
+
+
 Action::Action (istream& is) {
   u_.clear();
   v_.clear();
@@ -13,13 +17,33 @@ Action::Action (istream& is) {
       v_.push_back(Command(i, c2d(d)));
     }
     else {
-      cerr << "warning: only half an operation given for unit " << i << endl;
+      _log(LOG_WARNING, LOG_COMMAND, "only half an operation given for unit " << i);
+      return;
+    }
+  }
+}
+
+Action::Action (Tokenizer& t) : q_(0) {
+  int i;
+  while (t.read_int(i) and i != -1) {
+    char d;
+    if (t.read_char(d)) {
+      u_.insert(i);
+      v_.push_back(Command(i, c2d(d)));
+    }
+    else {
+      _log(LOG_WARNING, LOG_COMMAND, "only half an operation given for unit " << i);
       return;
     }
   }
 }
 
 void Action::print (const vector<Command>& commands, ostream& os) {
-  for (Command a : commands) os << a.id << ' ' << d2c(a.dir) << endl;
-  os << -1 << endl;
+  Writer w(os);
+  print(commands, w);
+}
+
+void Action::print (const vector<Command>& commands, Writer& w) {
+  for (Command a : commands) w << a.id << ' ' << d2c(a.dir) << '\n';
+  w << -1 << '\n';
 }
@@ -3,6 +3,9 @@
 
 
 #include "Structs.hh"
+#include "Log.hh"
+#include "Tokenizer.hh"
+#include "Writer.hh"
 
 /**
  * A command is defined by the id of a unit and a direction.
@@ -51,11 +54,18 @@ private:
   friend class Game;
   friend class SecGame;
   friend class Board;
+  friend class SimBoard;
+  friend class ReplayWriter;
+  friend class ReplayReader;
+  friend class ReplayView;
+  friend class IndexedReplay;
 
   /**
-   * Maximum number of commands allowed for a player during one round.
+   * Maximum number of commands allowed for a player during one round:
+   * at least MAX_COMMANDS, and more in large games (see Game::run).
    */
   static const int MAX_COMMANDS = 1000;
+  static int max_commands_;
 
   /**
    * Number of commands tried so far.
@@ -76,7 +86,9 @@ private:
    * Read/write commands to/from a stream.
    */
   Action (istream& is);
+  Action (Tokenizer& t);
   static void print (const vector<Command>& commands, ostream& os);
+  static void print (const vector<Command>& commands, Writer& w);
 
   /**
    * Conversion from char to Dir.
@@ -111,10 +123,10 @@ private:
 
 inline void Action::execute(Command m) {
   ++q_;
-  _my_assert(q_ <= MAX_COMMANDS, "Too many commands.");
+  _my_assert(q_ <= max_commands_, "Too many commands.");
 
   if (u_.find(m.id) != u_.end()) {
-    cerr << "warning: command already requested for unit " << m.id << endl;
+    _log(LOG_WARNING, LOG_COMMAND, "command already requested for unit " << m.id);
     return;
   }
 
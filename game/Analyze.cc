@@ -0,0 +1,416 @@
+#include <atomic>
+#include <thread>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "ReplayView.hh"
+
+
+/*! \file
+ * Aggregates statistics of many recorded games, in the text or binary
+ * format, read in parallel: heatmaps of events per bot and distributions
+ * per round, written to prefixheatmaps.csv and prefixrounds.csv, or to
+ * prefixstats.bin. E.g. ./Analyze -o out/ games/
+ *
+ * Events are deduced by comparing the states of consecutive rounds:
+ * a unit that changes owner, gains health or jumps more than one cell
+ * has been killed, at its previous position; if a unit of another player
+ * stands there now, it was killed by an attack of that player.
+ */
+
+
+enum Heatmap {
+  PRESENCE,   // Rounds with a unit of the bot in the cell.
+  INFECTIONS, // Units of the bot that got infected in the cell.
+  DEATHS,     // Units of the bot that were killed in the cell.
+  KILLS,      // Units killed by an attack of the bot in the cell.
+  MASKS,      // Masks picked up by the bot in the cell.
+  CAPTURES,   // Cities and paths conquered by the bot, for all their cells.
+  HEATMAP_SIZE
+};
+
+const char* heatmap_name[HEATMAP_SIZE] = {
+  "presence", "infections", "deaths", "kills", "masks", "captures"
+};
+
+
+/**
+ * Statistics of a bot after a round, summed over the seats it played.
+ */
+struct RoundStats {
+
+  long long seats    = 0;
+  long long score    = 0;
+  long long score2   = 0; // Sum of squares.
+  int       min      = INT_MAX;
+  int       max      = INT_MIN;
+  long long units    = 0;
+  long long infected = 0;
+  long long immune   = 0;
+
+  void add (const RoundStats& x) {
+    seats    += x.seats;
+    score    += x.score;
+    score2   += x.score2;
+    min       = std::min(min, x.min);
+    max       = std::max(max, x.max);
+    units    += x.units;
+    infected += x.infected;
+    immune   += x.immune;
+  }
+
+};
+
+
+/**
+ * Statistics of a bot over all the games it played.
+ */
+struct BotStats {
+
+  long long                  seats = 0;
+  vector< vector<long long> > heat;   // Per heatmap, per cell (row by row).
+  vector<RoundStats>         rounds;  // Per round, 0 to nb_rounds.
+
+  void add (const BotStats& x) {
+    seats += x.seats;
+    for (int h = 0; h < HEATMAP_SIZE; ++h)
+      for (int k = 0; k < int(heat[h].size()); ++k) heat[h][k] += x.heat[h][k];
+    for (int r = 0; r < int(rounds.size()); ++r) rounds[r].add(x.rounds[r]);
+  }
+
+};
+
+
+/**
+ * Statistics of a set of games with the same board size and number of rounds.
+ */
+struct Stats {
+
+  int                   rows;
+  int                   cols;
+  int              nb_rounds;
+  long long            games = 0;
+  map<string, BotStats> bots;
+
+  Stats (int rows, int cols, int nb_rounds) :
+    rows(rows), cols(cols), nb_rounds(nb_rounds) { }
+
+  BotStats& bot (const string& name) {
+    BotStats& b = bots[name];
+    if (b.heat.empty()) {
+      b.heat = vector< vector<long long> >(HEATMAP_SIZE, vector<long long>(rows*cols));
+      b.rounds = vector<RoundStats>(nb_rounds + 1);
+    }
+    return b;
+  }
+
+  void add (const Stats& x) {
+    games += x.games;
+    for (const auto& b : x.bots) bot(b.first).add(b.second);
+  }
+
+};
+
+
+/**
+ * Adds the statistics of the game in file to s.
+ */
+void analyze (const string& file, Stats& s) {
+  ReplayView g(file);
+  const Info& m = g.map();
+  if (m.rows() != s.rows or m.cols() != s.cols or m.nb_rounds() != s.nb_rounds) {
+    _log(LOG_WARNING, LOG_TOOL, "skipping " << file << ": different board or number of rounds");
+    return;
+  }
+
+  int np = m.nb_players();
+  int nu = m.total_units();
+  int cols = m.cols();
+  vector<BotStats*> bot(np);
+  for (int pl = 0; pl < np; ++pl) {
+    bot[pl] = &s.bot(g.names()[pl]);
+    ++bot[pl]->seats;
+  }
+  ++s.games;
+
+  auto at = [&] (int pl, Heatmap h, Pos p) -> long long& {
+    return bot[pl]->heat[h][p.i*cols + p.j];
+  };
+
+  vector<Unit> prev;
+  vector<int> prev_city, prev_path;
+  vector<int> unit_at(m.rows()*cols, -1);
+  for (const RoundView& r : g) {
+    if (r.round > s.nb_rounds) break;
+
+    for (int id = 0; id < nu; ++id) {
+      Pos p = r.units[id].pos;
+      if (m.pos_ok(p)) unit_at[p.i*cols + p.j] = id;
+    }
+
+    if (r.round > 0) {
+      for (int id = 0; id < nu; ++id) {
+        const Unit& u = r.units[id];
+        const Unit& v = prev[id];
+        int dist = abs(u.pos.i - v.pos.i) + abs(u.pos.j - v.pos.j);
+        if (u.player != v.player or u.health > v.health or dist > 1) {
+          at(v.player, DEATHS, v.pos) += 1;
+          int k = unit_at[v.pos.i*cols + v.pos.j];
+          if (k != -1 and r.units[k].player != v.player)
+            at(r.units[k].player, KILLS, v.pos) += 1;
+        }
+        else {
+          if (v.damage == 0 and not v.immune and u.damage > 0)
+            at(u.player, INFECTIONS, u.pos) += 1;
+          if (not v.mask and u.mask) at(u.player, MASKS, u.pos) += 1;
+        }
+      }
+
+      for (int c = 0; c < m.nb_cities(); ++c) {
+        int pl = r.city_owner[c];
+        if (pl != prev_city[c] and pl != -1)
+          for (Pos p : m.city(c)) at(pl, CAPTURES, p) += 1;
+      }
+      for (int c = 0; c < m.nb_paths(); ++c) {
+        int pl = r.path_owner[c];
+        if (pl != prev_path[c] and pl != -1)
+          for (Pos p : m.path(c).second) at(pl, CAPTURES, p) += 1;
+      }
+    }
+
+    for (int pl = 0; pl < np; ++pl) {
+      RoundStats& x = bot[pl]->rounds[r.round];
+      int sc = r.total_score[pl];
+      ++x.seats;
+      x.score  += sc;
+      x.score2 += (long long)sc*sc;
+      x.min     = min(x.min, sc);
+      x.max     = max(x.max, sc);
+    }
+    for (int id = 0; id < nu; ++id) {
+      const Unit& u = r.units[id];
+      RoundStats& x = bot[u.player]->rounds[r.round];
+      ++x.units;
+      if (u.damage > 0) ++x.infected;
+      if (u.immune) ++x.immune;
+      if (m.pos_ok(u.pos)) {
+        at(u.player, PRESENCE, u.pos) += 1;
+        unit_at[u.pos.i*cols + u.pos.j] = -1;
+      }
+    }
+
+    prev.assign(r.units, r.units + nu);
+    prev_city.assign(r.city_owner, r.city_owner + m.nb_cities());
+    prev_path.assign(r.path_owner, r.path_owner + m.nb_paths());
+  }
+}
+
+
+/**
+ * Returns whether file starts as a recorded game.
+ */
+bool is_game (const string& file) {
+  ifstream is(file, ifstream::binary);
+  char b[8] = { 0 };
+  is.read(b, 7);
+  return memcmp(b, ReplayWriter::MAGIC, 4) == 0 or
+         memcmp(b, "Game", 4) == 0 or memcmp(b, "SecGame", 7) == 0;
+}
+
+
+/**
+ * Adds to files the games in path, a file or a directory (not recursively).
+ */
+void list_games (const string& path, vector<string>& files) {
+  struct stat st;
+  _my_assert(stat(path.c_str(), &st) == 0, "Cannot open " + path + ".");
+  if (not S_ISDIR(st.st_mode)) {
+    files.push_back(path);
+    return;
+  }
+  DIR* dir = opendir(path.c_str());
+  _my_assert(dir, "Cannot open directory " + path + ".");
+  vector<string> v;
+  while (struct dirent* e = readdir(dir)) {
+    string f = path + "/" + e->d_name;
+    if (e->d_name[0] != '.' and stat(f.c_str(), &st) == 0 and
+        S_ISREG(st.st_mode) and is_game(f))
+      v.push_back(f);
+  }
+  closedir(dir);
+  sort(v.begin(), v.end());
+  files.insert(files.end(), v.begin(), v.end());
+}
+
+
+void write_csv (const Stats& s, const string& prefix) {
+  ofstream hf(prefix + "heatmaps.csv");
+  _my_assert(hf, "Cannot write " + prefix + "heatmaps.csv.");
+  Writer h(hf);
+  h << "bot,heatmap,i,j,count\n";
+  for (const auto& b : s.bots)
+    for (int t = 0; t < HEATMAP_SIZE; ++t)
+      for (int k = 0; k < s.rows*s.cols; ++k)
+        if (b.second.heat[t][k])
+          h << b.first << ',' << heatmap_name[t] << ',' << k / s.cols << ','
+            << k % s.cols << ',' << b.second.heat[t][k] << '\n';
+  h.flush();
+
+  ofstream rf(prefix + "rounds.csv");
+  _my_assert(rf, "Cannot write " + prefix + "rounds.csv.");
+  Writer w(rf);
+  w << "bot,round,seats,score_mean,score_sd,score_min,score_max,"
+    << "units_mean,infected_mean,immune_mean\n";
+  for (const auto& b : s.bots)
+    for (int r = 0; r <= s.nb_rounds; ++r) {
+      const RoundStats& x = b.second.rounds[r];
+      if (x.seats == 0) continue;
+      double n = x.seats;
+      double mean = x.score/n;
+      double sd = sqrt(max(0.0, x.score2/n - mean*mean));
+      w << b.first << ',' << r << ',' << x.seats << ',' << mean << ',' << sd << ','
+        << x.min << ',' << x.max << ',' << x.units/n << ',' << x.infected/n << ','
+        << x.immune/n << '\n';
+    }
+  w.flush();
+}
+
+
+void varint (Writer& w, unsigned long long x) {
+  while (x >= 0x80) {
+    w << char(0x80 | (x & 0x7f));
+    x >>= 7;
+  }
+  w << char(x);
+}
+
+void svarint (Writer& w, long long x) {
+  varint(w, (unsigned long long)(x << 1) ^ (unsigned long long)(x >> 63));
+}
+
+
+/**
+ * Writes the statistics in binary: the magic "PNDA" followed by varints
+ * (zigzag coded if they can be negative): version, rows, cols, nb_rounds,
+ * games and number of bots; then for every bot its name (length and
+ * chars), seats, its heatmaps cell by cell, and for every round seats,
+ * score, score2, min, max, units, infected and immune.
+ */
+void write_binary (const Stats& s, const string& prefix) {
+  ofstream os(prefix + "stats.bin", ofstream::binary);
+  _my_assert(os, "Cannot write " + prefix + "stats.bin.");
+  Writer w(os);
+  w << "PNDA";
+  for (long long x : {1LL, (long long)s.rows, (long long)s.cols, (long long)s.nb_rounds,
+                      s.games, (long long)s.bots.size()})
+    varint(w, x);
+  for (const auto& b : s.bots) {
+    varint(w, b.first.size());
+    w << b.first;
+    varint(w, b.second.seats);
+    for (const vector<long long>& h : b.second.heat)
+      for (long long x : h) varint(w, x);
+    for (const RoundStats& x : b.second.rounds) {
+      varint(w, x.seats);
+      svarint(w, x.score);
+      varint(w, x.score2);
+      svarint(w, x.seats ? x.min : 0);
+      svarint(w, x.seats ? x.max : 0);
+      varint(w, x.units);
+      varint(w, x.infected);
+      varint(w, x.immune);
+    }
+  }
+  w.flush();
+}
+
+
+void help (char** argv) {
+  cout << "Usage: " << argv[0] << " [options] game_or_directory ..." << endl;
+  cout << "Available options:" << endl;
+  cout << "--output=prefix -o prefix   prefix of the output files (default: none)" << endl;
+  cout << "--binary        -b          write prefixstats.bin instead of CSV files"<< endl;
+  cout << "--threads=n     -j n        number of threads (default: all cores)"    << endl;
+  cout << "--help          -h          print help"                                << endl;
+}
+
+
+int main (int argc, char** argv) {
+  struct option long_options[] = {
+    { "output",  required_argument, 0, 'o' },
+    { "binary",  no_argument,       0, 'b' },
+    { "threads", required_argument, 0, 'j' },
+    { "help",    no_argument,       0, 'h' },
+    { 0, 0, 0, 0 }
+  };
+
+  string prefix;
+  bool binary = false;
+  int nb_threads = 0;
+
+  while (true) {
+    int index = 0;
+    int c = getopt_long(argc, argv, "o:bj:h", long_options, &index);
+    if (c == -1) break;
+
+    switch (c) {
+      case 'o':
+        prefix = optarg;
+        break;
+      case 'b':
+        binary = true;
+        break;
+      case 'j':
+        nb_threads = string_to_int(optarg);
+        break;
+      case 'h':
+      default:
+        help(argv);
+        return EXIT_SUCCESS;
+    }
+  }
+  if (optind == argc) {
+    help(argv);
+    return EXIT_SUCCESS;
+  }
+
+  vector<string> files;
+  for (int k = optind; k < argc; ++k) list_games(argv[k], files);
+  _my_assert(not files.empty(), "No games found.");
+
+  // All games are compared with the first one.
+  int rows, cols, nb_rounds;
+  {
+    ReplayView g(files[0]);
+    rows = g.map().rows();
+    cols = g.map().cols();
+    nb_rounds = g.map().nb_rounds();
+  }
+
+  int nf = files.size();
+  if (nb_threads <= 0) nb_threads = max(1u, thread::hardware_concurrency());
+  nb_threads = min(nb_threads, nf);
+
+  // Every thread has its own statistics, which are only made of sums,
+  // so the result does not depend on which thread reads each game.
+  vector<Stats> part(nb_threads, Stats(rows, cols, nb_rounds));
+  atomic<int> next_file(0);
+  auto worker = [&] (int t) {
+    for (int f = next_file++; f < nf; f = next_file++) analyze(files[f], part[t]);
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < nb_threads; ++t) pool.push_back(thread(worker, t));
+  worker(0);
+  for (thread& th : pool) th.join();
+
+  Stats s(rows, cols, nb_rounds);
+  for (const Stats& p : part) s.add(p);
+
+  if (binary) write_binary(s, prefix);
+  else write_csv(s, prefix);
+  _log(LOG_INFO, LOG_TOOL, s.games << " games, " << s.bots.size() << " bots");
+  Log::flush();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+
+#include "Board.hh"
+
+
+/*! \file
+ * Benchmark of the engine on games of several sizes: plays rounds with
+ * random commands for all units and reports the time per round, also
+ * relative to the number of cells plus units, which should stay roughly
+ * constant if a round takes linear time.
+ */
+
+
+/**
+ * Size of a benchmarked game.
+ */
+struct Size {
+  int players, rows, cols, units;
+};
+
+
+/**
+ * Sizes benchmarked by default, from the standard game upwards.
+ */
+const vector<Size> SIZES = {
+  {  4,   70,   70,   15 },
+  {  4,  200,  200,  100 },
+  {  8,  500,  300,  300 },
+  { 16, 1000, 1000, 1000 },
+  { 32, 2000, 1000, 1000 },
+  { 40, 2000, 2000, 1000 },
+};
+
+
+/**
+ * Returns the configuration of a game of the given size.
+ */
+string settings (const Size& s, int rounds) {
+  ostringstream oss;
+  oss << Settings::version()              << '\n'
+      << "nb_players "                 << s.players << '\n'
+      << "rows "                       << s.rows    << '\n'
+      << "cols "                       << s.cols    << '\n'
+      << "nb_rounds "                  << rounds    << '\n'
+      << "initial_health 100\n"
+      << "nb_units "                   << s.units   << '\n'
+      << "bonus_per_city_cell 1\n"
+      << "bonus_per_path_cell 1\n"
+      << "factor_connected_component 2\n"
+      << "infection_factor 50\n"
+      << "mask_protection 20\n"
+      << "GENERATOR1 1\n";
+  return oss.str();
+}
+
+
+double seconds_since (chrono::steady_clock::time_point t) {
+  return chrono::duration<double>(chrono::steady_clock::now() - t).count();
+}
+
+
+/**
+ * Plays a game of the given size and prints a line of results.
+ */
+void bench (const Size& s, int rounds, int seed) {
+  auto t0 = chrono::steady_clock::now();
+  istringstream is(settings(s, rounds));
+  Board b(is, seed);
+  double gen = seconds_since(t0);
+
+  srand(seed);
+  ostringstream os;
+  double total = 0;
+  for (int round = 0; round < rounds; ++round) {
+    // Every unit moves in a random direction, or stays.
+    vector<Action> act(s.players);
+    for (int pl = 0; pl < s.players; ++pl)
+      for (int id : b.my_units(pl))
+        if (rand() % 8) act[pl].move(id, Dir(rand() % DIR_SIZE));
+
+    os.str("");
+    auto t = chrono::steady_clock::now();
+    b.next(act, os);
+    total += seconds_since(t);
+  }
+
+  long long cells = (long long)s.rows * s.cols;
+  long long units = (long long)s.players * s.units;
+  double round_ms = 1e3 * total / rounds;
+  cout << setw(7)  << s.players
+       << setw(7)  << s.rows
+       << setw(7)  << s.cols
+       << setw(9)  << units
+       << setw(10) << cells
+       << setw(10) << fixed << setprecision(1) << 1e3 * gen
+       << setw(11) << fixed << setprecision(3) << round_ms
+       << setw(10) << fixed << setprecision(1) << 1e6 * round_ms / (cells + units)
+       << endl;
+}
+
+
+int main (int argc, char** argv) {
+  if (argc != 3 and argc != 7) {
+    cout << "Usage: " << argv[0] << " rounds seed [players rows cols units]" << endl;
+    cout << "Without a size, benchmarks a range of sizes." << endl;
+    return EXIT_SUCCESS;
+  }
+  int rounds = string_to_int(argv[1]);
+  int seed   = string_to_int(argv[2]);
+  _my_assert(rounds >= 1, "Wrong number of rounds.");
+
+  vector<Size> sizes = SIZES;
+  if (argc == 7)
+    sizes = {{ string_to_int(argv[3]), string_to_int(argv[4]),
+               string_to_int(argv[5]), string_to_int(argv[6]) }};
+
+  Log::set_level(LOG_ERROR);
+  cout << "players   rows   cols    units     cells    gen ms   round ms  ns/(c+u)" << endl;
+  for (const Size& s : sizes) bench(s, rounds, seed);
+}
@@ -1,5 +1,9 @@
+#include <mutex>
+#include <thread>
+
 #include "Board.hh"
 #include "Action.hh"
+#include "MapCache.hh"
 
 
 const char Board::uNDEF = gRASS;
@@ -26,9 +30,10 @@ void Board::generate_units () {
 
 Board::Board (istream& is, int seed) {
   set_random_seed(seed);
-  *static_cast<Settings*>(this) = Settings::read_settings(is);
+  Tokenizer t(is);
+  *static_cast<Settings*>(this) = Settings::read_settings(t);
   names_ = vector<string>(nb_players());
-  read_generator_and_grid(is);
+  read_generator_and_grid(t);
 
   round_ = 0;
   total_score_ = vector<int>   (nb_players(), 0);
@@ -41,122 +46,227 @@ Board::Board (istream& is, int seed) {
 }
 
 
+Board::Board (const Info& info, int seed) : Info(info) {
+  set_random_seed(seed);
+  names_ = vector<string>(nb_players());
+}
+
+
+void Board::checkpoint () {
+  checkpoints_.push_back({
+    int(cell_log_.size()),
+    int(unit_log_.size()),
+    int(city_owner_log_.size()),
+    int(path_owner_log_.size()),
+    int(pl_units_log_.size()),
+    int(mask_log_.size()),
+    int(score_log_.size()),
+    round_,
+    rnd_seed
+  });
+}
+
+
+void Board::rollback () {
+  _my_assert(journaling(), "No checkpoint to roll back to.");
+  const Checkpoint& c = checkpoints_.back();
+
+  // Old values are restored in reverse order, so the oldest one prevails.
+  while (int(cell_log_.size()) > c.cells) {
+    Pos p = cell_log_.back().first;
+    grid_[p.i][p.j] = cell_log_.back().second;
+    cell_log_.pop_back();
+  }
+  while (int(unit_log_.size()) > c.units) {
+    unit_[unit_log_.back().id] = unit_log_.back();
+    unit_log_.pop_back();
+  }
+  while (int(city_owner_log_.size()) > c.city_owners) {
+    city_owner_[city_owner_log_.back().first] = city_owner_log_.back().second;
+    city_owner_log_.pop_back();
+  }
+  while (int(path_owner_log_.size()) > c.path_owners) {
+    path_owner_[path_owner_log_.back().first] = path_owner_log_.back().second;
+    path_owner_log_.pop_back();
+  }
+  while (int(pl_units_log_.size()) > c.pl_units) {
+    int pl = pl_units_log_.back(); pl_units_log_.pop_back();
+    int sz = pl_units_log_.back(); pl_units_log_.pop_back();
+    auto it = pl_units_log_.end() - sz;
+    pl_units_[pl].assign(it, pl_units_log_.end());
+    pl_units_log_.erase(it, pl_units_log_.end());
+  }
+  while (int(mask_log_.size()) > c.masks) {
+    int sz = mask_log_.back().i; mask_log_.pop_back();
+    auto it = mask_log_.end() - sz;
+    masks_.assign(it, mask_log_.end());
+    mask_log_.erase(it, mask_log_.end());
+  }
+  while (int(score_log_.size()) > c.scores) {
+    auto it = score_log_.end() - nb_players();
+    total_score_.assign(it, score_log_.end());
+    score_log_.erase(it, score_log_.end());
+  }
+  round_   = c.round;
+  rnd_seed = c.seed;
+  checkpoints_.pop_back();
+}
+
+
+void Board::commit () {
+  _my_assert(journaling(), "No checkpoint to commit.");
+  checkpoints_.pop_back();
+  if (not journaling()) {
+    cell_log_.clear();
+    unit_log_.clear();
+    city_owner_log_.clear();
+    path_owner_log_.clear();
+    pl_units_log_.clear();
+    mask_log_.clear();
+    score_log_.clear();
+  }
+}
+
+
 void Board::print_settings (ostream& os) const {
-  // Should match the format of *.cnf files, except for the last line of board generation.
-  os << version() << endl;
-  os << "nb_players                  " << nb_players()                 << endl;
-  os << "rows                        " << rows()                       << endl;
-  os << "cols                        " << cols()                       << endl;
-  os << "nb_rounds                   " << nb_rounds()                  << endl;
-  os << "initial_health              " << initial_health()             << endl;
-  os << "nb_units                    " << nb_units()                   << endl;
-  os << "bonus_per_city_cell         " << bonus_per_city_cell()        << endl;
-  os << "bonus_per_path_cell         " << bonus_per_path_cell()        << endl;
-  os << "factor_connected_component  " << factor_connected_component() << endl;
-  os << "infection_factor            " << infection_factor()           << endl;
-  os << "mask_protection             " << mask_protection()            << endl;
+  Writer w(os);
+  print_settings(w);
 }
 
 
 void Board::print_names (ostream& os) const {
-  os << "names         ";
-  for (int pl = 0; pl < nb_players(); ++pl) os << ' ' << name(pl);
-  os << endl;
+  Writer w(os);
+  print_names(w);
 }
 
 
 void Board::print_state (ostream& os) const {
+  Writer w(os);
+  print_state(w);
+}
+
+
+void Board::print_settings (Writer& w) const {
+  // Should match the format of *.cnf files, except for the last line of board generation.
+  w << version() << '\n';
+  w << "nb_players                  " << nb_players()                 << '\n';
+  w << "rows                        " << rows()                       << '\n';
+  w << "cols                        " << cols()                       << '\n';
+  w << "nb_rounds                   " << nb_rounds()                  << '\n';
+  w << "initial_health              " << initial_health()             << '\n';
+  w << "nb_units                    " << nb_units()                   << '\n';
+  w << "bonus_per_city_cell         " << bonus_per_city_cell()        << '\n';
+  w << "bonus_per_path_cell         " << bonus_per_path_cell()        << '\n';
+  w << "factor_connected_component  " << factor_connected_component() << '\n';
+  w << "infection_factor            " << infection_factor()           << '\n';
+  w << "mask_protection             " << mask_protection()            << '\n';
+}
+
+
+void Board::print_names (Writer& w) const {
+  w << "names         ";
+  for (int pl = 0; pl < nb_players(); ++pl) w << ' ' << name(pl);
+  w << '\n';
+}
+
+
+void Board::print_static (Writer& w) const {
+  w << '\n';
+  w << "cities " << city_.size() << '\n';
+  for (int k = 0; k < int(city_.size()); ++k) {
+    w << '\n' << city_[k].size() << '\n';
+    for (auto x: city_[k]) {
+      w << x.i << " " << x.j << '\n';
+    }
+  }
+
+  w << '\n';
+  w << "paths " << path_.size() << '\n';
+  for (int k = 0; k < int(path_.size()); ++k) {
+    w << '\n'
+      << path_[k].first.first << " " << path_[k].first.second << " "
+      << path_[k].second.size() << '\n';
+    for (auto x: path_[k].second) {
+      w << x.i << " " << x.j << '\n';
+    }
+  }
+}
+
+
+void Board::print_state (Writer& w, bool statics) const {
 
   // Should start with the same format of Info::read_grid.
   // Then other data describing the state.
 
-  os << endl << endl;
+  w << '\n' << '\n';
 
-  os << "   ";
+  w << "   ";
   for (int j = 0; j < cols(); ++j)
-    os << j / 10;
-  os << endl;
+    w << j / 10;
+  w << '\n';
 
-  os << "   ";
+  w << "   ";
   for (int j = 0; j < cols(); ++j)
-    os << j % 10;
-  os << endl;
+    w << j % 10;
+  w << '\n';
 
   for (int i = 0; i < rows(); ++i) {
-    os << i / 10 << i % 10 << " ";
+    w << i / 10 << i % 10 << " ";
     for (int j = 0; j < cols(); ++j) {
       const Cell& c = grid_[i][j];
-      if (c.type == WALL) os << CellType2char(c.type);
+      if (c.type == WALL) w << CellType2char(c.type);
       if (c.type == GRASS) {
-	if (c.virus == 0) os << CellType2char(c.type);
-	else os << char('a' + c.virus - 1);
+	if (c.virus == 0) w << CellType2char(c.type);
+	else w << char('a' + c.virus - 1);
       }
       if (c.type == PATH) {
-	if (c.virus == 0) os << ',';
-	else os << char('0' + c.virus - 1);
+	if (c.virus == 0) w << ',';
+	else w << char('0' + c.virus - 1);
       }
       if (c.type == CITY) {
-	if (c.virus == 0) os << ';';
-	else os << char('A' + c.virus - 1);
+	if (c.virus == 0) w << ';';
+	else w << char('A' + c.virus - 1);
       }
     }
-    os << endl;
+    w << '\n';
   }
 
-  os << endl;
-  os << "cities " << city_.size() << endl;
-  for (int k = 0; k < int(city_.size()); ++k) {
-    os << endl << city_[k].size() << endl;
-    for (auto x: city_[k]) {
-      os << x.i << " " << x.j << endl;
-    }
-  }
+  if (statics) print_static(w);
 
-  os << endl;
-  os << "paths " << path_.size() << endl;
-  for (int k = 0; k < int(path_.size()); ++k) {
-    os << endl
-       << path_[k].first.first << " " << path_[k].first.second << " "
-       << path_[k].second.size() << endl;
-    for (auto x: path_[k].second) {
-      os << x.i << " " << x.j << endl;
-    }
-  }
-
-  os << endl;
-  os << "masks " << masks_.size() << endl;
+  w << '\n';
+  w << "masks " << masks_.size() << '\n';
   for (int k = 0; k < int(masks_.size()); ++k) {
-    os << masks_[k].i << " " << masks_[k].j << " " << endl;
+    w << masks_[k].i << " " << masks_[k].j << " " << '\n';
   }
 
-  os << endl;
-  os << "round " << round() << endl;
+  w << '\n';
+  w << "round " << round() << '\n';
 
-  os << "total_score";
-  for (auto ts : total_score_) os << " " << ts;
-  os << endl;
+  w << "total_score";
+  for (auto ts : total_score_) w << " " << ts;
+  w << '\n';
 
-  os << "status";
-  for (auto st : cpu_status_) os << " " << st;
-  os << endl;
+  w << "status";
+  for (auto st : cpu_status_) w << " " << st;
+  w << '\n';
 
-  os << endl;
-  os << "city_owners" << endl;
-  for (int owner : city_owner_) os << " " << owner;
-  os << endl;
+  w << '\n';
+  w << "city_owners" << '\n';
+  for (int owner : city_owner_) w << " " << owner;
+  w << '\n';
 
-  os << endl;
-  os << "path_owners" << endl;
-  for (int owner : path_owner_) os << " " << owner;
-  os << endl;
+  w << '\n';
+  w << "path_owners" << '\n';
+  for (int owner : path_owner_) w << " " << owner;
+  w << '\n';
 
-  os << endl;
-  os << "units" << endl;
+  w << '\n';
+  w << "units" << '\n';
   for (int id = 0; id < total_units(); ++id) {
-    print_unit(unit(id), os);
-    os << endl;
+    print_unit(unit(id), w);
+    w << '\n';
   }
-  os << endl;
+  w << '\n';
 }
 
 
@@ -164,8 +274,7 @@ void Board::print_results () const {
   int max_score = 0;
   vector<int> v;
   for (int pl = 0; pl < nb_players(); ++pl) {
-    cerr << "info: player " << name(pl)
-         << " got score " << total_score(pl) << endl;
+    _log(LOG_INFO, LOG_GAME, "player " << name(pl) << " got score " << total_score(pl));
     if (total_score(pl) > max_score) {
       max_score = total_score(pl);
       v = vector<int>(1, pl);
@@ -173,16 +282,33 @@ void Board::print_results () const {
     else if (total_score(pl) == max_score) v.push_back(pl);
   }
 
-  cerr << "info: player(s)";
-  for (int pl : v) cerr << " " << name(pl);
-  cerr << " got top score" << endl;
+  ostringstream oss;
+  for (int pl : v) oss << " " << name(pl);
+  _log(LOG_INFO, LOG_GAME, "player(s)" << oss.str() << " got top score");
 }
 
 
 void Board::next(const vector<Action>& act, ostream& os) {
+  Writer w(os);
+  next(act, w);
+}
+
+
+void Board::next(const vector<Action>& act, Writer& w) {
 
   _my_assert(ok(), "Invariants are not satisfied.");
 
+  vector<Command> commands_done;
+  apply(act, commands_done);
+  w << "commands\n";
+  Action::print(commands_done, w);
+
+  _my_assert(ok(), "Invariants are not satisfied.");
+}
+
+
+void Board::apply(const vector<Action>& act, vector<Command>& commands_done) {
+
   ++round_;
 
   int np = nb_players();
@@ -196,16 +322,16 @@ void Board::next(const vector<Action>& act, ostream& os) {
       int id = m.id;
       Dir dir = m.dir;
       if (not unit_ok(id))
-        cerr << "warning: id out of range : " << id << endl;
+        _log(LOG_WARNING, LOG_COMMAND, "id out of range : " << id)
       else if (unit(id).player != pl)
-        cerr << "warning: unit " << id << " of player " << unit(id).player
-             << " not owned by " << pl << endl;
+        _log(LOG_WARNING, LOG_COMMAND, "unit " << id << " of player " << unit(id).player
+             << " not owned by " << pl)
       else {
         // Here it is an assert because repetitions should have already been filtered out.
         _my_assert(not seen[id], "More than one command for the same unit.");
         seen[id] = true;
         if (not dir_ok(dir))
-          cerr << "warning: direction not valid: " << dir << endl;
+          _log(LOG_WARNING, LOG_COMMAND, "direction not valid: " << dir)
         else if (dir != NONE)
           v.push_back(Command(id, dir));
       }
@@ -215,20 +341,21 @@ void Board::next(const vector<Action>& act, ostream& os) {
   int num = v.size();
   vector<int> perm = random_permutation(num);
   vector<bool> killed(nu, false);
-  vector<Command> commands_done;
+  commands_done.clear();
   for (int i = 0; i < num; ++i) {
     Command m = v[perm[i]];
     if (not killed[m.id] and move(m.id, m.dir, killed))
       commands_done.push_back(m);
   }
-  os << "commands" << endl;
-  Action::print(commands_done, os);
-  
+
   propagate(killed);
 
   // To ensure that executions of Game and SecGame are the same.
   for (int pl = 0; pl < np; ++pl)
-    sort(pl_units_[pl].begin(), pl_units_[pl].end());
+    if (not is_sorted(pl_units_[pl].begin(), pl_units_[pl].end())) {
+      save_player_units(pl);
+      sort(pl_units_[pl].begin(), pl_units_[pl].end());
+    }
 
   vector<int> dead;
   for (int id = 0; id < nu; ++id)
@@ -239,8 +366,6 @@ void Board::next(const vector<Action>& act, ostream& os) {
   if (round_%5 == 0 and round_ < nb_rounds()) spawn_mask();
 
   compute_total_scores();
-
-  _my_assert(ok(), "Invariants are not satisfied.");
 }
 
 // Spawns a mask in a GRASS cell without any units in it and without any mask on it
@@ -255,6 +380,8 @@ void Board::spawn_mask() {
 		if (c.type == GRASS and c.unit_id == -1 and not c.mask) found = true;
 	}
 	if (found) {
+		save_cell(Pos(i, j));
+		save_masks();
 		grid_[i][j].mask = true;
 		masks_.push_back(Pos(i, j));
 		return;
@@ -265,6 +392,8 @@ void Board::spawn_mask() {
 		for (int j = 0; j < cols(); ++j) {
 			Cell& c = grid_[i][j];
 			if (c.type == GRASS and c.unit_id == -1 and not c.mask) {
+				save_cell(Pos(i, j));
+				save_masks();
 				c.mask = true;
 				masks_.push_back(Pos(i, j));
 				return;
@@ -290,6 +419,7 @@ void Board::propagate(vector<bool>& killed) {
 	for (int id = 0; id < (int)unit_.size(); ++id) {
 		if (not killed[id] and unit_[id].damage > 0 and not unit_[id].mask) {
 			Pos p = unit_[id].pos;
+			save_cell(p);
 			Cell& c = grid_[p.i][p.j];
 			c.virus += 3;
 			//if (c.type == CITY or c.type == PATH) c.virus = min(10, c.virus);
@@ -311,12 +441,14 @@ void Board::propagate(vector<bool>& killed) {
 			new_grid[i][j].virus = vir;
 			if (new_grid[i][j].type == GRASS) new_grid[i][j].virus = min(vir, 4);
 			else new_grid[i][j].virus = min(vir, 10);
+			if (new_grid[i][j].virus != grid_[i][j].virus) save_cell(Pos(i, j));
 		}
 	}
 	grid_ = new_grid;
 	
 	for (int id = 0; id < (int)unit_.size(); ++id) {
 		Unit& u = unit_[id];
+		if (not killed[id] and not u.immune) save_unit(id);
 		if (not killed[id]) {
 			// Infect susceptible units
 			if (u.damage == 0 and not u.immune) {
@@ -341,42 +473,45 @@ void Board::propagate(vector<bool>& killed) {
 	
 	// Deal damage to infected units
 	for (int id = 0; id < (int)unit_.size(); ++id) {
+		if (unit_[id].damage != 0) save_unit(id);
 		unit_[id].health -= unit_[id].damage;
 		if (unit_[id].health < 0) {
-			kill(id, random(0, 3), killed);
+			kill(id, random(0, nb_players() - 1), killed);
 		}
 	}	
 }
 
 void Board::spawn(const vector<int>& gen) {
 
-  // Generate set of candidate positions for generation.
-  set<Pos> cands;
-  
+  // Generate set of candidate positions for generation, sorted.
+  vector<Pos> cands;
   for (int i = 1; i + 1 < rows(); ++i) {
-	  cands.insert(Pos(i, 1));
-	  cands.insert(Pos(i, cols() - 2));
+    cands.push_back(Pos(i, 1));
+    cands.push_back(Pos(i, cols() - 2));
   }
   for (int j = 1; j + 1 < cols(); ++j) {
-	  cands.insert(Pos(1, j));
-	  cands.insert(Pos(rows() - 2, j));
+    cands.push_back(Pos(1, j));
+    cands.push_back(Pos(rows() - 2, j));
   }
-  
+  sort(cands.begin(), cands.end());
+  cands.erase(unique(cands.begin(), cands.end()), cands.end());
+
+  // Cell from which the exhaustive search goes on. The cells before it
+  // are not valid, and placing units cannot make them valid.
+  int next = 0;
+
   // Regenerate killed units using valid candidate positions.
   for (int id : gen) {
     Pos pos = Pos(-1, -1);
     while (pos == Pos(-1, -1) and not cands.empty()) {
       int k = random(0, cands.size()-1);
-      auto it = cands.begin();
-      advance(it, k);
-      if (valid_to_spawn(*it)) pos = *it;
-      cands.erase(it);
+      if (valid_to_spawn(cands[k])) pos = cands[k];
+      cands.erase(cands.begin() + k);
     }
     if (pos == Pos(-1, -1)) // This should very very rarely happen.
-      for (int i = 0; i < rows() and pos == Pos(-1, -1); ++i)
-        for (int j = 0; j < cols() and pos == Pos(-1, -1); ++j)
-          if (valid_to_spawn(Pos(i, j)))
-            pos = Pos(i, j);
+      for (; next < rows()*cols() and pos == Pos(-1, -1); ++next)
+        if (valid_to_spawn(Pos(next / cols(), next % cols())))
+          pos = Pos(next / cols(), next % cols());
     _my_assert(pos != Pos(-1, -1), "Cannot find a cell to regenerate units");
     place(id, pos);
   }
@@ -398,6 +533,8 @@ bool Board::valid_to_spawn(Pos pos) {
 void Board::place(int id, Pos p) {
   _my_assert(unit_ok(id), "Invalid identifier.");
   _my_assert( pos_ok( p), "Invalid position.");
+  save_unit(id);
+  save_cell(p);
   unit_[id].pos = p;
   grid_[p.i][p.j].unit_id = id;
 }
@@ -410,9 +547,13 @@ void Board::kill(int id, int pl, vector<bool>& killed) {
   killed[id] = true;
 
   Unit& u = unit_[id];
+  save_unit(id);
+  save_cell(u.pos);
   grid_[u.pos.i][u.pos.j].unit_id = -1;
 
   if (pl != u.player) {
+    save_player_units(u.player);
+    save_player_units(pl);
     auto& o = pl_units_[u.player];
     auto it = find(o.begin(), o.end(), id);
     _my_assert(it != o.end(), "Cannot find id to kill.");
@@ -461,16 +602,21 @@ bool Board::move(int id, Dir dir, vector<bool>& killed) {
     Unit& u2 = unit_[id2];
     _my_assert(u2.health >= 0, "Health cannot be negative.");
     if (u2.player == u.player) return false;
+    save_unit(id2);
     int damage = random(25, 40);
     u2.health -= damage;
     if (u2.health < 0) kill(id2,  u.player, killed);
     else return false;
   }
 
+  save_cell(p1);
+  save_cell(p2);
+  save_unit(id);
   c1.unit_id = -1;
   c2.unit_id = id;
   u.pos = p2;
   if (c2.mask == true and u.mask == false) {
+    save_masks();
 		u.mask = true;
 		c2.mask = false;
 		auto it = find(masks_.begin(), masks_.end(), p2);
@@ -498,11 +644,11 @@ void Board::compute_scores_city_or_path(int bonus, const vector<Pos>& v, int& ow
     else if (sc[pl] == max_sc) max_pl = -1;
   }
   if (max_pl != -1) {     // Change of owner.
-    total_score_[max_pl] += bonus * v.size();
+    add_score(total_score_[max_pl], (long long)bonus * v.size());
     owner = max_pl;
   }
   else if (owner != -1) { // The owner is the same.
-    total_score_[owner] += bonus * v.size();
+    add_score(total_score_[owner], (long long)bonus * v.size());
   }
 }
 
@@ -546,19 +692,26 @@ void Board::compute_scores_graph(int pl) {
   for (int u = 0; u < sz; ++u)
     if (not mkd[u]) {
       int s = size_of_connected_component_of(u, g, mkd);
-      _my_assert(0 <= s and s <= 25, "Unexpected size of connected component.");
-      total_score_[pl] += factor_connected_component() * int(1 << s);
+      add_score(total_score_[pl], connected_component_bonus(factor_connected_component(), s));
     }
 }
 
 
 void Board::compute_total_scores () {
 
-  for (int k = 0; k < int(city_.size()); ++k)
+  save_scores();
+
+  for (int k = 0; k < int(city_.size()); ++k) {
+    int old = city_owner_[k];
     compute_scores_city_or_path(bonus_per_city_cell(), city_[k], city_owner_[k]);
+    if (journaling() and city_owner_[k] != old) city_owner_log_.push_back({k, old});
+  }
 
-  for (int k = 0; k < int(path_.size()); ++k)
+  for (int k = 0; k < int(path_.size()); ++k) {
+    int old = path_owner_[k];
     compute_scores_city_or_path(bonus_per_path_cell(), path_[k].second, path_owner_[k]);
+    if (journaling() and path_owner_[k] != old) path_owner_log_.push_back({k, old});
+  }
 
   for (int pl = 0; pl < nb_players(); ++pl)
     compute_scores_graph(pl);
@@ -575,29 +728,120 @@ const vector<int> Board::DIRJ4 = { 0,  1,  0, -1};
 const vector<int> Board::DIRI8 = {  1,  1,  1,  0, -1, -1, -1,  0};
 const vector<int> Board::DIRJ8 = { -1,  0,  1,  1,  1,  0, -1, -1};
 
+void Board::generate (const string& generator, const vector<int>& param) {
+  // Everything the generation depends on: settings, generator and
+  // state of the random generator.
+  string key;
+  if (MapCache::enabled()) {
+    ostringstream oss;
+    print_settings(oss);
+    oss << generator;
+    for (int x : param) oss << ' ' << x;
+    oss << '\n' << rnd_seed << '\n';
+    key = oss.str();
+
+    long long seed;
+    if (MapCache::load(key, *this, seed)) {
+      rnd_seed = seed;
+      return;
+    }
+  }
+
+  if (generator == "GENERATOR1") generator1(param);
+  else                           generator2(param);
+
+  if (MapCache::enabled()) MapCache::save(key, *this, rnd_seed);
+}
+
+
+int Board::generator_threads_ = 0;
+
+
+void Board::set_generator_threads (int n) {
+  _my_assert(n >= 0, "Wrong number of generator threads.");
+  generator_threads_ = n;
+}
+
+
+bool Board::generation_attempt () {
+  clear_map();
+  city_.clear();
+  path_.clear();
+
+  fill_borders_with_walls();
+  place_cities();
+  place_old_cities();
+  place_paths();
+  place_walls();
+
+  recode_temp();
+
+  return valid();
+}
+
+
+long long Board::sub_seed (long long seed, int k) {
+  // splitmix64, so that close seeds and attempts give unrelated sub-seeds.
+  unsigned long long z = seed + (unsigned long long)(k + 1)*0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return z & RANDOM_MASK;
+}
+
+
+void Board::speculative_generation () {
+  const long long seed = rnd_seed;
+  int n = generator_threads_;
+  if (n == 0) n = max(1u, thread::hardware_concurrency());
+
+  // Threads take attempts in increasing order, and stop at the first one
+  // not below the best valid attempt so far. Hence all attempts below the
+  // chosen one have been tried, whatever the number of threads.
+  const Board base(*this); // Board receives the chosen attempt.
+  atomic<int> next(0);
+  atomic<int> best(INT_MAX);
+  mutex mtx;
+
+  auto worker = [&]() {
+    for (int k = next++; k < best; k = next++) {
+      Board b(base);
+      b.rnd_seed = sub_seed(seed, k);
+      if (b.generation_attempt()) {
+        lock_guard<mutex> lock(mtx);
+        if (k < best) {
+          best = k;
+          m.swap(b.m);
+          city_.swap(b.city_);
+          path_.swap(b.path_);
+          rnd_seed = b.rnd_seed;
+        }
+      }
+    }
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < n; ++t) pool.push_back(thread(worker));
+  worker();
+  for (thread& th : pool) th.join();
+}
+
+
 void Board::generator1 (const vector<int>& param) {
 
-  _my_assert(param.empty(), "GENERATOR1 requires no parameter.");
+  _my_assert(param.empty() or (param.size() == 1 and (param[0] == 0 or param[0] == 1)),
+             "GENERATOR1 requires no parameter, 0 or 1.");
 
   margin = min(rows(), cols()) / 5;
 
-  bool found = false;
-  while (not found) {
-    m = vector<vector<char>>(rows(), vector<char>(cols(), uNDEF));
-    city_.clear();
-    path_.clear();
+  if (not param.empty() and param[0] == 1) speculative_generation();
+  else while (not generation_attempt());
 
-    fill_borders_with_walls();
-    place_cities();
-    place_old_cities();
-    place_paths();
-    place_walls();
-    
-    recode_temp();
+  grid_from_map();
+}
 
-    found = valid();
-  }
 
+void Board::grid_from_map () {
   grid_ = vector< vector<Cell> >(rows(), vector<Cell>(cols()));
   for (int i = 0; i < rows(); ++i)
     for (int j = 0; j < cols(); ++j)
@@ -615,3 +859,221 @@ void Board::generator1 (const vector<int>& param) {
       grid_[x.i][x.j].path_id = k;
     }
 }
+
+
+namespace {
+
+  /**
+   * Points of the board in square buckets, to find the nearest ones.
+   */
+  class Buckets {
+
+    const vector<Pos>& p;
+    int side, bi, bj;
+    vector< vector<int> > bucket;
+
+  public:
+
+    Buckets (const vector<Pos>& p, int rows, int cols, int side) :
+      p(p), side(side), bi(rows/side + 1), bj(cols/side + 1), bucket(bi*bj) {
+      for (int k = 0; k < int(p.size()); ++k)
+        bucket[(p[k].i/side)*bj + p[k].j/side].push_back(k);
+    }
+
+    /**
+     * Returns the (at most) n points nearest to q other than skip, by
+     * distance and then by index.
+     */
+    vector<int> nearest (Pos q, int n, int skip = -1) const {
+      vector< pair<int,int> > cand; // Squared distance and index.
+      int ci = q.i/side;
+      int cj = q.j/side;
+      for (int r = 0; r <= max(bi, bj); ++r) {
+        // Points r buckets away are at least (r-1)*side away.
+        if (int(cand.size()) >= n and r > 0) {
+          nth_element(cand.begin(), cand.begin() + n-1, cand.end());
+          if (cand[n-1].first < (r-1)*side*(r-1)*side) break;
+        }
+        for (int i = ci-r; i <= ci+r; ++i)
+          for (int j = cj-r; j <= cj+r; ++j)
+            if (max(abs(i - ci), abs(j - cj)) == r
+                and i >= 0 and i < bi and j >= 0 and j < bj)
+              for (int k : bucket[i*bj + j])
+                if (k != skip) {
+                  int di = p[k].i - q.i;
+                  int dj = p[k].j - q.j;
+                  cand.push_back({di*di + dj*dj, k});
+                }
+      }
+      sort(cand.begin(), cand.end());
+      vector<int> res;
+      for (int k = 0; k < min(n, int(cand.size())); ++k) res.push_back(cand[k].second);
+      return res;
+    }
+
+  };
+
+}
+
+
+vector<Pos> Board::poisson_disc (int r) {
+  // Bridson's algorithm. A bucket of side r/sqrt(2) holds a sample at most.
+  const int lo = 1 + MIN_DISTANCE_OF_CITIES + max(MAX_CITY_VER_SIDE, MAX_CITY_HOR_SIDE)/2;
+  const int hi_i = rows() - 1 - lo;
+  const int hi_j = cols() - 1 - lo;
+  vector<Pos> res;
+  if (hi_i < lo or hi_j < lo) return res;
+
+  const double side = r/sqrt(2.0);
+  const int bi = int((hi_i - lo)/side) + 1;
+  const int bj = int((hi_j - lo)/side) + 1;
+  vector<int> bucket(bi*bj, -1);
+  vector< pair<double,double> > s;
+  vector<int> active;
+
+  auto add = [&](double i, double j) {
+    bucket[int((i - lo)/side)*bj + int((j - lo)/side)] = s.size();
+    active.push_back(s.size());
+    s.push_back({i, j});
+  };
+
+  auto far = [&](double i, double j) {
+    int ci = int((i - lo)/side);
+    int cj = int((j - lo)/side);
+    for (int ii = max(0, ci-2); ii <= min(bi-1, ci+2); ++ii)
+      for (int jj = max(0, cj-2); jj <= min(bj-1, cj+2); ++jj) {
+        int k = bucket[ii*bj + jj];
+        if (k >= 0) {
+          double di = s[k].first  - i;
+          double dj = s[k].second - j;
+          if (di*di + dj*dj < r*r) return false;
+        }
+      }
+    return true;
+  };
+
+  add(random(lo, hi_i), random(lo, hi_j));
+  while (not active.empty()) {
+    int a = random(0, active.size()-1);
+    bool found = false;
+    for (int t = 0; t < POISSON_TRIES and not found; ++t) {
+      double angle = 2*M_PI*uniform();
+      double d     = r*(1 + uniform());
+      double i = s[active[a]].first  + d*cos(angle);
+      double j = s[active[a]].second + d*sin(angle);
+      if (i >= lo and i <= hi_i and j >= lo and j <= hi_j and far(i, j)) {
+        add(i, j);
+        found = true;
+      }
+    }
+    if (not found) {
+      active[a] = active.back();
+      active.pop_back();
+    }
+  }
+
+  for (auto x : s) res.push_back(Pos(int(std::round(x.first)), int(std::round(x.second))));
+  return res;
+}
+
+
+void Board::generator2 (const vector<int>& param) {
+
+  _my_assert(param.size() <= 3, "GENERATOR2 requires at most 3 parameters.");
+  int dist    = param.size() > 0 ? param[0] : 12;
+  int nearest = param.size() > 1 ? param[1] : 2;
+  int old_pct = param.size() > 2 ? param[2] : 30;
+  _my_assert(dist >= 8 and dist <= 1000, "Wrong distance between cities in GENERATOR2.");
+  _my_assert(nearest >= 1 and nearest <= 10, "Wrong number of nearest cities in GENERATOR2.");
+  _my_assert(old_pct >= 0 and old_pct <= 100, "Wrong percentage of old cities in GENERATOR2.");
+
+  clear_map();
+  city_.clear();
+  path_.clear();
+  fill_borders_with_walls();
+
+  // Cities and old cities around the samples. A few may not fit, but
+  // the first sample always gets a city.
+  vector<Pos> center;
+  vector<Pos> old_center;
+  vector<Box> old_box;
+  for (Pos x : poisson_disc(dist)) {
+    bool old = random(1, 100) <= old_pct and not city_.empty();
+    int di = random(MIN_CITY_VER_SIDE + old, MAX_CITY_VER_SIDE);
+    int dj = random(MIN_CITY_HOR_SIDE + old, MAX_CITY_HOR_SIDE);
+    int i = x.i - di/2;
+    int j = x.j - dj/2;
+    const int D = MIN_DISTANCE_OF_CITIES;
+    if (old) {
+      if (old_city_valid(i, j, di, dj)) {
+        for (int ii = i; ii < i+di; ++ii)
+          for (int jj = j; jj < j+dj; ++jj)
+            set_cell(ii, jj, tEMP);
+        old_center.push_back(x);
+        old_box.push_back({i, j, i+di, j+dj});
+      }
+    }
+    else if (city_valid(i, j, di, dj) and count(tEMP, {i-D, j-D, i+di+D, j+dj+D}) == 0) {
+      City c;
+      for (int ii = i; ii < i+di; ++ii)
+        for (int jj = j; jj < j+dj; ++jj) {
+          set_cell(ii, jj, cITY);
+          c.push_back({ii, jj});
+        }
+      city_.push_back(c);
+      center.push_back(x);
+    }
+  }
+  _my_assert(not city_.empty(), "GENERATOR2 cannot place cities on this board.");
+
+  // Paths between near cities, shortest first, so that they seldom cross.
+  Buckets near_cities(center, rows(), cols(), dist);
+  vector< pair<int, pair<int,int>> > edge;
+  for (int a = 0; a < int(center.size()); ++a)
+    for (int b : near_cities.nearest(center[a], nearest, a)) {
+      int di = center[a].i - center[b].i;
+      int dj = center[a].j - center[b].j;
+      edge.push_back({di*di + dj*dj, {min(a, b), max(a, b)}});
+    }
+  sort(edge.begin(), edge.end());
+  edge.erase(unique(edge.begin(), edge.end()), edge.end());
+
+  vector<Box> box = city_boxes();
+  for (const auto& e : edge) {
+    int a = e.second.first;
+    int b = e.second.second;
+    for (int t = 0; t < PATH_TRIES; ++t) {
+      Pos p1 = city_[a][random(0, city_[a].size()-1)];
+      Pos p2 = city_[b][random(0, city_[b].size()-1)];
+      const auto& c0 = curve_from(p1.i, p1.j, Prob4{*this, p2.i, p2.j}, false);
+      if (c0.back() == p2 and path_valid(c0, a, b, box)) {
+        add_path(c0, a, b);
+        break;
+      }
+    }
+  }
+
+  // Walls from old cities to their nearest cities.
+  for (int k = 0; k < int(old_box.size()); ++k) {
+    const Box& o = old_box[k];
+    Pos p1(random(o.i0, o.i1-1), random(o.j0, o.j1-1));
+    int a = near_cities.nearest(old_center[k], 1)[0];
+    Pos p2 = city_[a][random(0, city_[a].size()-1)];
+    vector<Pos> c0 = wall_from(p2, p1);
+    if (wall_valid(c0)) {
+      vector<Pos> c;
+      for (auto x : c0)
+        if (m[x.i][x.j] == gRASS) {
+          set_cell(x.i, x.j, wALL);
+          c.push_back(x);
+        }
+      if (not keeps_connected(c))
+        for (auto x : c) set_cell(x.i, x.j, gRASS);
+    }
+  }
+
+  recode_temp();
+  _my_assert(is_connected(), "GENERATOR2 made a board which is not connected.");
+
+  grid_from_map();
+}
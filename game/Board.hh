@@ -20,38 +20,48 @@ class Board : public Info, public Random_generator {
 
   friend class Game;
   friend class SecGame;
+  friend class Simulation;
+  friend class JournalCheck;
+  friend class ReplayWriter;
+  friend class ReplayReader;
 
   vector<string> names_;
 
   /**
    * Reads the generator method, and generates or reads the grid.
    */
-  void read_generator_and_grid (istream& is) {
-    string generator_;
-    is >> generator_;
-    if (generator_ == "FIXED") read_grid(is);
+  void read_generator_and_grid (Tokenizer& t) {
+    string generator_ = t.next().str();
+    if (generator_ == "FIXED") read_grid(t);
     else {
       vector<int> param;
       int x;
-      while (is >> x) param.push_back(x);
-      _my_assert(generator_ == "GENERATOR1", "Unknown grid generator.");
-      generator1(param);
+      while (t.read_int(x)) param.push_back(x);
+      _my_assert(generator_ == "GENERATOR1" or generator_ == "GENERATOR2",
+                 "Unknown grid generator.");
+      generate(generator_, param);
     }
   }
 
+  /**
+   * Generates the grid with the given generator, or loads it from the
+   * map cache if it is enabled and already has it.
+   */
+  void generate (const string& generator, const vector<int>& param);
+
 
   /**
    * Prints some information of the unit.
    */
-  inline static void print_unit (Unit u, ostream& os) {
-    os << u.player << ' '
-       << u.pos.i  << ' '
-       << u.pos.j  << ' '
-       << u.health << ' '
-       << u.damage << ' '
-       << u.turns << ' '
-       << u.immune << ' '
-       << u.mask << ' ';
+  inline static void print_unit (Unit u, Writer& w) {
+    w << u.player << ' '
+      << u.pos.i  << ' '
+      << u.pos.j  << ' '
+      << u.health << ' '
+      << u.damage << ' '
+      << u.turns << ' '
+      << u.immune << ' '
+      << u.mask << ' ';
   }
 
   bool valid_to_spawn(Pos pos);
@@ -93,6 +103,69 @@ class Board : public Info, public Random_generator {
    */
   void generate_units ();
 
+  /**
+   * Applies the given actions to the current board, without checking
+   * the invariants. Stores in done the commands actually performed.
+   */
+  void apply (const vector<Action>& act, vector<Command>& done);
+
+
+  /////////////////////// BEGIN UNDO JOURNAL ///////////////////////
+
+  // While there is some checkpoint, every modification of the board
+  // first saves the old value in one of these logs.
+
+  struct Checkpoint {
+    int cells, units, city_owners, path_owners, pl_units, masks, scores;
+    int round;
+    long long seed;
+  };
+
+  vector<Checkpoint>          checkpoints_;
+  vector<pair<Pos, Cell>>        cell_log_;
+  vector<Unit>                   unit_log_;
+  vector<pair<int, int>>   city_owner_log_;
+  vector<pair<int, int>>   path_owner_log_;
+  vector<int>                pl_units_log_; // Ids, then size, then player.
+  vector<Pos>                   mask_log_; // Masks, then (size, -1).
+  vector<int>                  score_log_; // Scores of all players.
+
+  inline bool journaling () const {
+    return not checkpoints_.empty();
+  }
+
+  inline void save_cell (Pos p) {
+    if (journaling()) cell_log_.push_back({p, grid_[p.i][p.j]});
+  }
+
+  inline void save_unit (int id) {
+    if (journaling()) unit_log_.push_back(unit_[id]);
+  }
+
+  inline void save_player_units (int pl) {
+    if (journaling()) {
+      const vector<int>& v = pl_units_[pl];
+      pl_units_log_.insert(pl_units_log_.end(), v.begin(), v.end());
+      pl_units_log_.push_back(v.size());
+      pl_units_log_.push_back(pl);
+    }
+  }
+
+  inline void save_masks () {
+    if (journaling()) {
+      mask_log_.insert(mask_log_.end(), masks_.begin(), masks_.end());
+      mask_log_.push_back(Pos(masks_.size(), -1));
+    }
+  }
+
+  inline void save_scores () {
+    if (journaling())
+      score_log_.insert(score_log_.end(), total_score_.begin(), total_score_.end());
+  }
+
+  /////////////////////// END UNDO JOURNAL ///////////////////////
+
+
 
   /////////////////////// BEGIN BOARD GENERATION ///////////////////////
 
@@ -100,10 +173,53 @@ class Board : public Info, public Random_generator {
   static const char tEMP = 't';
 
   /**
-   * Generates a board.
+   * Generates a board. Attempts are repeated until the board is valid.
+   * With parameter 1 they are speculative: attempt k starts from a
+   * sub-seed of the seed and k, attempts are tried in parallel, and the
+   * first valid one is chosen, so the board does not depend on the
+   * number of threads.
    */
   void generator1 (const vector<int>& param);
 
+  // Threads for speculative generation (0 for one per core).
+  static int generator_threads_;
+
+  // Makes one attempt of generator1 from the current random state.
+  // Returns whether the board is valid.
+  bool generation_attempt ();
+
+  // Returns the seed of the k-th speculative attempt.
+  static long long sub_seed (long long seed, int k);
+
+  void speculative_generation ();
+
+  /**
+   * Generates a board in one pass, in time about linear in its area.
+   * Cities and old cities are spread with Poisson-disc sampling, every
+   * city is joined by paths to its nearest cities, and every old city
+   * gets a wall towards its nearest city unless the wall would cut off
+   * some cells. Optional parameters: min distance between the centers
+   * of cities (12), number of nearest cities to join (2), and
+   * percentage of old cities (30).
+   */
+  void generator2 (const vector<int>& param);
+
+  // Returns the samples of a Poisson-disc distribution with distance r,
+  // far enough from the borders to put a city around each of them.
+  vector<Pos> poisson_disc (int r);
+
+  // Builds grid_ from m, city_ and path_.
+  void grid_from_map ();
+
+  // Candidates around a sample in poisson_disc().
+  static const int POISSON_TRIES = 30;
+
+  // Tries to route a path between two near cities in generator2.
+  static const int PATH_TRIES = 5;
+
+  // Margin of the boxes searched by keeps_connected().
+  static const int WALL_CHECK_MARGIN = 8;
+
   // Min and max number of *attempts* to place forests, etc.
   static const int MIN_NUM_CITIES      = 8;
   static const int MAX_NUM_CITIES      = 22;
@@ -117,6 +233,10 @@ class Board : public Info, public Random_generator {
   static const int MIN_DISTANCE_OF_CITIES   =  3; // ... between cities.
   static const int MIN_DISTANCE_OF_WALLS    =  2; // ... between walls.
 
+  // Radius of the boxes counted in near().
+  static const int NEAR_RADIUS = MIN_DISTANCE_OF_PATHS;
+  static_assert(MIN_DISTANCE_OF_WALLS == NEAR_RADIUS, "Walls are checked with near().");
+
   // Min and max horizontal and vertical sides of squares for cities.
   static const int MIN_CITY_HOR_SIDE  = 2;
   static const int MIN_CITY_VER_SIDE  = 2;
@@ -142,6 +262,132 @@ class Board : public Info, public Random_generator {
   vector<vector<char>> m;
   vector<Pos> w;
 
+  // Scratch grid of the generator: a cell is marked if its stamp is the
+  // current generation, so that clearing it is just starting a new one.
+  vector<int> stamp_;
+  int generation_ = 0;
+
+  // Buffer of the last curve returned by curve_from().
+  vector<Pos> curve_;
+
+  // Stack of the cells to visit in traversal().
+  vector<Pos> stack_;
+
+  // Kinds of cells of m whose proximity is checked.
+  static const int NB_KINDS = 4;
+
+  // For every kind, number of its cells in the box of radius NEAR_RADIUS
+  // around every cell, updated by set_cell().
+  vector<int> near_[NB_KINDS];
+
+  // For every kind, 2D prefix sums of its cells, rebuilt by count()
+  // if m has changed since.
+  vector<int> sum_[NB_KINDS];
+  bool        dirty_[NB_KINDS];
+
+  // Max area of the boxes that count() scans instead of using the sums.
+  static const int SCAN_AREA = 256;
+
+  // Rectangle [i0, i1) x [j0, j1).
+  struct Box {
+    int i0, j0, i1, j1;
+  };
+
+  static int kind(char c) {
+    switch (c) {
+      case wALL: return 0;
+      case cITY: return 1;
+      case pATH: return 2;
+      case tEMP: return 3;
+      default:   return -1;
+    }
+  }
+
+  // Empties m and the counts of the kinds.
+  void clear_map() {
+    m = vector<vector<char>>(rows(), vector<char>(cols(), uNDEF));
+    for (int k = 0; k < NB_KINDS; ++k) {
+      near_[k].assign(rows()*cols(), 0);
+      dirty_[k] = true;
+    }
+  }
+
+  // Adds d to the counts of the kind of char c around (i, j).
+  void count_cell(int i, int j, char c, int d) {
+    int k = kind(c);
+    if (k < 0) return;
+    const int D = NEAR_RADIUS;
+    for (int ii = max(0, i-D); ii <= min(rows()-1, i+D); ++ii)
+      for (int jj = max(0, j-D); jj <= min(cols()-1, j+D); ++jj)
+        near_[k][ii*cols() + jj] += d;
+    dirty_[k] = true;
+  }
+
+  // Sets the cell (i, j) of m to c, keeping the counts up to date.
+  void set_cell(int i, int j, char c) {
+    if (m[i][j] == c) return;
+    count_cell(i, j, m[i][j], -1);
+    m[i][j] = c;
+    count_cell(i, j, c, +1);
+  }
+
+  // Returns the number of cells with c in the box of radius NEAR_RADIUS
+  // centered at (i, j).
+  int near(char c, int i, int j) const {
+    return near_[kind(c)][i*cols() + j];
+  }
+
+  // Returns the number of cells with c in b (clipped to the board).
+  // Small boxes of a changed m are scanned rather than rebuilding the sums.
+  int count(char c, Box b) {
+    int k = kind(c);
+    int C = cols() + 1;
+    vector<int>& s = sum_[k];
+    if (dirty_[k] and area(b) <= SCAN_AREA) {
+      b = intersection(b, {0, 0, rows(), cols()});
+      int n = 0;
+      for (int i = b.i0; i < b.i1; ++i)
+        for (int j = b.j0; j < b.j1; ++j)
+          n += m[i][j] == c;
+      return n;
+    }
+    if (dirty_[k]) {
+      s.assign((rows() + 1)*C, 0);
+      for (int i = 0; i < rows(); ++i)
+        for (int j = 0; j < cols(); ++j)
+          s[(i+1)*C + j+1] = s[i*C + j+1] + s[(i+1)*C + j] - s[i*C + j] + (m[i][j] == c);
+      dirty_[k] = false;
+    }
+    b = intersection(b, {0, 0, rows(), cols()});
+    if (b.i0 >= b.i1 or b.j0 >= b.j1) return 0;
+    return s[b.i1*C + b.j1] - s[b.i0*C + b.j1] - s[b.i1*C + b.j0] + s[b.i0*C + b.j0];
+  }
+
+  static Box intersection(const Box& a, const Box& b) {
+    return {max(a.i0, b.i0), max(a.j0, b.j0), min(a.i1, b.i1), min(a.j1, b.j1)};
+  }
+
+  static int area(const Box& b) {
+    return max(0, b.i1 - b.i0) * max(0, b.j1 - b.j0);
+  }
+
+  // Unmarks all the cells of the scratch grid.
+  void new_generation() {
+    if (int(stamp_.size()) != rows()*cols() or generation_ == INT_MAX) {
+      stamp_.assign(rows()*cols(), 0);
+      generation_ = 0;
+    }
+    ++generation_;
+  }
+
+  bool marked(int i, int j) const {
+    return stamp_[i*cols() + j] == generation_;
+  }
+
+  void mark(int i, int j) {
+    stamp_[i*cols() + j] = generation_;
+  }
+
   
   // Returns true with probability p.
   bool bernoulli(double p) {
@@ -164,26 +410,6 @@ class Board : public Info, public Random_generator {
       j >= cols()/2 - d  and  j <= cols()/2 + d - 1;
   }
 
-  // Returns whether there is a cell in the box of radius d
-  // centered at (i, j) that contains character c.
-  bool neighbour_one_of(const vector<vector<char>>& t, int i, int j, int d, char c) {
-    for (int ii = max(0, i-d); ii <= min(rows()-1, i+d); ++ii)
-      for (int jj = max(0, j-d); jj <= min(cols()-1, j+d); ++jj)
-        if (t[ii][jj] == c)
-          return true;
-    return false;
-  }
-
-  // Returns whether there is a cell in the box of radius d
-  // centered at (i, j) that contains an integer different from -1, a, b.
-  bool neighbour_none_of(const vector<vector<int>>& t, int i, int j, int d, int a, int b) {
-    for (int ii = max(0, i-d); ii <= min(rows()-1, i+d); ++ii)
-      for (int jj = max(0, j-d); jj <= min(cols()-1, j+d); ++jj)
-        if (t[ii][jj] != -1 and t[ii][jj] != a and t[ii][jj] != b)
-          return true;
-    return false;
-  }
-
   // Returns the L^p distance between a and b.
   static double distance(const pair<double,double>& a, const pair<double,double>& b, double p = 2) {
     double first  = pow(abs(a.first  - b.first),  p);
@@ -196,26 +422,25 @@ class Board : public Info, public Random_generator {
     return i >= 0 and i < rows() and j >= 0 and j < cols();
   }
 
-  // Returns the number of elements in the matrix that are marked.
-  static int size(const vector<vector<bool>>& mkd) {
+  // Returns the number of cells of the scratch grid that are marked.
+  int marked_size() const {
     int sz = 0;
-    for (int i = 0; i < int(mkd.size()); ++i)
-      for (int j = 0; j < int(mkd[0].size()); ++j)
-        sz += mkd[i][j];
+    for (int k = 0; k < int(stamp_.size()); ++k)
+      sz += stamp_[k] == generation_;
     return sz;
   }
 
-  // Returns a matrix where an area around position (i0, j0) is marked.
+  // Marks in the scratch grid an area around position (i0, j0).
   template <class Prob>
-  vector<vector<bool>> mark_area_around(int i0, int j0, Prob prob, bool allow_diags = true) {
+  void mark_area_around(int i0, int j0, Prob prob, bool allow_diags = true) {
 
     const vector<int>& diri = allow_diags ? DIRI8 : DIRI4;
     const vector<int>& dirj = allow_diags ? DIRJ8 : DIRJ4;
 
-    vector<vector<bool>> mkd(rows(), vector<bool>(cols(), false));
+    new_generation();
     queue<Pos> q;
     q.push({i0, j0});
-    mkd[i0][j0] = true;
+    mark(i0, j0);
     while (not q.empty()) {
       int i = q.front().i;
       int j = q.front().j;
@@ -223,9 +448,9 @@ class Board : public Info, public Random_generator {
       for (int k = 0; k < int(diri.size()); ++k) {
         int ii = i + diri[k];
         int jj = j + dirj[k];
-        if (inside(ii, jj) and not mkd[ii][jj] and prob(ii, jj)) {
+        if (inside(ii, jj) and not marked(ii, jj) and prob(ii, jj)) {
           q.push({ii, jj});
-          mkd[ii][jj] = true;
+          mark(ii, jj);
         }
       }
     }
@@ -235,44 +460,47 @@ class Board : public Info, public Random_generator {
       changed = false;
       for (int i = 2; i < rows()-2; ++i)
         for (int j = 2; j < cols()-2; ++j) {
-          if (mkd[i-1][j] and not mkd[i][j] and mkd[i+1][j]) {
-            mkd[i][j] = true;
+          if (marked(i-1, j) and not marked(i, j) and marked(i+1, j)) {
+            mark(i, j);
             changed = true;
           }
-          if (mkd[i][j-1] and not mkd[i][j] and mkd[i][j+1]) {
-            mkd[i][j] = true;
+          if (marked(i, j-1) and not marked(i, j) and marked(i, j+1)) {
+            mark(i, j);
             changed = true;
           }
-          if (mkd[i-1][j] and not mkd[i][j] and not mkd[i+1][j] and mkd[i+2][j]) {
-            mkd[i][j] = mkd[i+1][j] = true;
+          if (marked(i-1, j) and not marked(i, j) and not marked(i+1, j) and marked(i+2, j)) {
+            mark(i, j);
+            mark(i+1, j);
             changed = true;
           }
-          if (mkd[i][j-1] and not mkd[i][j] and not mkd[i][j+1] and mkd[i][j+2]) {
-            mkd[i][j] = mkd[i][j+1] = true;
+          if (marked(i, j-1) and not marked(i, j) and not marked(i, j+1) and marked(i, j+2)) {
+            mark(i, j);
+            mark(i, j+1);
             changed = true;
           }
         }
     }
-    return mkd;
   }
 
 
   // Returns a vector of positions representing a curve starting at (i0, j0).
+  // It is valid until the next call.
   template <class Prob>
-  vector<Pos> curve_from(int i0, int j0, Prob prob, bool allow_diags = true) {
+  const vector<Pos>& curve_from(int i0, int j0, Prob prob, bool allow_diags = true) {
 
     const vector<int>& diri = allow_diags ? DIRI8 : DIRI4;
     const vector<int>& dirj = allow_diags ? DIRJ8 : DIRJ4;
     const int D = diri.size();
 
-    vector<Pos> curve;
-    vector<vector<bool>> mkd(rows(), vector<bool>(cols(), false));
+    vector<Pos>& curve = curve_;
+    curve.clear();
+    new_generation();
     int i = i0;
     int j = j0;
     int k = random(0, D-1);
     while (true) {
       curve.push_back({i, j});
-      mkd[i][j] = true;
+      mark(i, j);
       int s, ii, jj, kk;
       for (s = -2; s <= 1; ++s) {
         if (s < -1) kk = k + random(-1, 1); // First try random
@@ -282,7 +510,7 @@ class Board : public Info, public Random_generator {
         _my_assert(0 <= kk and kk < D, "In curve generation.");
         ii = i + diri[kk];
         jj = j + dirj[kk];
-        if (inside(ii, jj) and not mkd[ii][jj] and prob(i, j, ii, jj)) break;
+        if (inside(ii, jj) and not marked(ii, jj) and prob(i, j, ii, jj)) break;
       }
       if (s <= 1) { // Found a new point for the curve.
         i = ii;
@@ -340,18 +568,25 @@ class Board : public Info, public Random_generator {
     Board& b;
     int i0, j0;
 
-    // True if (ii, jj) is closer to (i0, j0) than (i, j)
+    // True if (ii, jj) is closer to (i0, j0) than (i, j). Squared
+    // distances are compared, which gives the same result.
     bool operator()(int i, int j, int ii, int jj) {
-      double  d = distance({i0, j0}, { i,  j});
-      double dd = distance({i0, j0}, {ii, jj});
+      int  d = (i  - i0)*(i  - i0) + (j  - j0)*(j  - j0);
+      int dd = (ii - i0)*(ii - i0) + (jj - j0)*(jj - j0);
       return d > dd;
     }
   };
 
 
   void fill_borders_with_walls() {
-    for (int k = 0; k < rows(); ++k) m[k][0] = m[k][cols()-1] = wALL;
-    for (int k = 0; k < cols(); ++k) m[0][k] = m[rows()-1][k] = wALL;
+    for (int k = 0; k < rows(); ++k) {
+      set_cell(k, 0, wALL);
+      set_cell(k, cols()-1, wALL);
+    }
+    for (int k = 0; k < cols(); ++k) {
+      set_cell(0, k, wALL);
+      set_cell(rows()-1, k, wALL);
+    }
   }
   
 
@@ -359,11 +594,8 @@ class Board : public Info, public Random_generator {
   // (di, dj) is far enough of the sea, other cities or the central square.
   bool city_valid(int i, int j, int di, int dj) {
     const int D = MIN_DISTANCE_OF_CITIES;
-    for (int ii = max(0, i-D); ii < min(rows(), i+di+D-1); ++ii)
-      for (int jj = max(0, j-D); jj < min(cols(), j+dj+D-1); ++jj)
-        if (m[ii][jj] == wALL or m[ii][jj] == cITY)
-          return false;
-    return true;
+    Box b = {i-D, j-D, i+di+D-1, j+dj+D-1};
+    return count(wALL, b) == 0 and count(cITY, b) == 0;
   }
 
 
@@ -384,7 +616,7 @@ class Board : public Info, public Random_generator {
           c.push_back({ii, jj});
 
       for (auto x : c)
-        m[x.i][x.j] = cITY;
+        set_cell(x.i, x.j, cITY);
     }
     return c;
   }
@@ -403,26 +635,53 @@ class Board : public Info, public Random_generator {
   // Returns whether path p is too close to another existing path or
   // city (different from its leaving and arriving cities) or crosses
   // the central square.
+  // Cities are rectangles, given in box, so the cells of a and b around
+  // a cell are counted as intersections.
   bool path_valid(const vector<Pos>& p,
                int a, int b,
-               const vector<vector<int>>& mkd) {
+               const vector<Box>& box) {
     const int D = MIN_DISTANCE_OF_PATHS;
-    for (auto x : p)
-      if (neighbour_one_of(   m, x.i, x.j, D, pATH) or
-					neighbour_one_of(   m, x.i, x.j, D, tEMP) or
-          neighbour_none_of(mkd, x.i, x.j, D, a, b))
-        return false;
+    for (auto x : p) {
+      if (near(pATH, x.i, x.j) > 0 or near(tEMP, x.i, x.j) > 0) return false;
+      Box around = {x.i-D, x.j-D, x.i+D+1, x.j+D+1};
+      int own = area(intersection(around, box[a])) + area(intersection(around, box[b]));
+      if (near(cITY, x.i, x.j) > own) return false;
+    }
     return true;
   }
 
 
+  // Returns the boxes of the cities, which must be rectangles.
+  vector<Box> city_boxes() {
+    int n_cities = city_.size();
+    vector<Box> box(n_cities);
+    for (int k = 0; k < n_cities; ++k) {
+      box[k] = {rows(), cols(), 0, 0};
+      for (const auto& x : city_[k])
+        box[k] = {min(box[k].i0, x.i), min(box[k].j0, x.j),
+                  max(box[k].i1, x.i+1), max(box[k].j1, x.j+1)};
+      _my_assert(area(box[k]) == int(city_[k].size()), "City is not a rectangle.");
+    }
+    return box;
+  }
+
+
+  // Adds a path from city a to city b along curve c0.
+  void add_path(const vector<Pos>& c0, int a, int b) {
+    vector<Pos> c;
+    for (auto x : c0)
+      if (m[x.i][x.j] != cITY) { // Skin those cells from the
+        set_cell(x.i, x.j, pATH); // curve belonging to cities.
+        c.push_back(x);
+      }
+    path_.push_back({{a, b}, c});
+  }
+
+
   void place_paths() {
 
-    vector<vector<int>> mkd(rows(), vector<int>(cols(), -1));
     int n_cities = city_.size();
-    for (int k = 0; k < n_cities; ++k)
-      for (const auto& x : city_[k])
-        mkd[x.i][x.j] = k;
+    vector<Box> box = city_boxes();
 
     int n_paths = 3*n_cities*n_cities;
     for (int k = 0; k < n_paths; ++k) {
@@ -435,17 +694,10 @@ class Board : public Info, public Random_generator {
         int j1 = city_[a][pa].j;
         int i2 = city_[b][pb].i;
         int j2 = city_[b][pb].j;
-        auto c0 = curve_from(i1, j1, Prob4{*this, i2, j2}, false);
+        const auto& c0 = curve_from(i1, j1, Prob4{*this, i2, j2}, false);
         if (c0.back() == Pos{i2, j2} and  // From (i1, j1) to (i2, j2).
-            path_valid(c0, a, b, mkd)) {
-          vector<Pos> c;
-          for (auto x : c0)
-            if (m[x.i][x.j] != cITY) { // Skin those cells from the
-              m[x.i][x.j] = pATH;      // curve belonging to cities.
-              c.push_back(x);
-            }
-          path_.push_back({{a, b}, c});
-        }
+            path_valid(c0, a, b, box))
+          add_path(c0, a, b);
       }
     }
   }
@@ -453,12 +705,9 @@ class Board : public Info, public Random_generator {
   // Returns whether old cities are far enough from everything
   bool old_city_valid(int i, int j, int di, int dj) {
     const int D = MIN_DISTANCE_OF_CITIES;
-    for (int ii = max(0, i-D); ii < min(rows(), i+di+D-1); ++ii)
-      for (int jj = max(0, j-D); jj < min(cols(), j+dj+D-1); ++jj)
-        if (m[ii][jj] == wALL or m[ii][jj] == cITY or m[ii][jj] == pATH
-         or m[ii][jj] == tEMP)
-          return false;
-    return true;
+    Box b = {i-D, j-D, i+di+D-1, j+dj+D-1};
+    return count(wALL, b) == 0 and count(cITY, b) == 0
+       and count(pATH, b) == 0 and count(tEMP, b) == 0;
   }
 
 
@@ -475,7 +724,7 @@ class Board : public Info, public Random_generator {
     if (found) {
       for (int ii = i; ii < min(rows(), i+di); ++ii) {
         for (int jj = j; jj < min(cols(), j+dj); ++jj) {
-          m[ii][jj] = tEMP; // They will become walls later
+          set_cell(ii, jj, tEMP); // They will become walls later
           w.push_back(Pos(ii, jj));
 				}
 			}
@@ -492,15 +741,33 @@ class Board : public Info, public Random_generator {
   
   
   bool wall_valid(vector<Pos>& c) {
-		const int D = MIN_DISTANCE_OF_WALLS;
 		for (auto x : c) {
-			if (neighbour_one_of(m, x.i, x.j, D, wALL) or
-					neighbour_one_of(m, x.i, x.j, D, pATH)) return false;
+			if (near(wALL, x.i, x.j) > 0 or near(pATH, x.i, x.j) > 0) return false;
 		}
 		return true;
 	}
 	
 	
+	// Returns the cells of a wall along a curve from p2 to p1, made of
+	// segments that are either up or down.
+	vector<Pos> wall_from(Pos p2, Pos p1) {
+		const auto& c0 = curve_from(p2.i, p2.j, Prob4{*this, p1.i, p1.j}, false);
+		double p = (double)random(55,75)/100.;
+		vector<Pos> c;
+		int l = 5;
+		bool up = false;
+		for (auto x : c0) {
+			if (l == 0) {
+				up = bernoulli(p); // Decide whether a segment of length l
+				l = random(3,6);   // of the wall will be up or down
+			}
+			if (up) c.push_back(x);
+			--l;
+		}
+		return c;
+	}
+
+
 	void place_walls() {
 		int count = 0;
 		if (w.size() == 0) return;
@@ -516,21 +783,9 @@ class Board : public Info, public Random_generator {
 			int di = p1.i - p2.i;
 			int dj = p1.j - p2.j;
 			if (di*di + dj*dj > 2*MAX_CITY_HOR_SIDE*MAX_CITY_VER_SIDE) {
-				auto c0 = curve_from(p2.i, p2.j, Prob4{*this, p1.i, p1.j}, false);
-				double p = (double)random(55,75)/100.;
-				vector<Pos> c;
-				int l = 5;
-				bool up = false;
-				for (auto x : c0) {
-					if (l == 0) {
-						up = bernoulli(p); // Decide whether a segment of length l
-						l = random(3,6);   // of the wall will be up or down
-					}
-					if (up) c.push_back(x);
-					--l;
-				}
+				vector<Pos> c = wall_from(p2, p1);
 				if (wall_valid(c)) {
-					for (auto x : c) if(m[x.i][x.j] == gRASS) m[x.i][x.j] = wALL;
+					for (auto x : c) if (m[x.i][x.j] == gRASS) set_cell(x.i, x.j, wALL);
 					++count;
 				}
 			}
@@ -542,35 +797,87 @@ class Board : public Info, public Random_generator {
 	void recode_temp() {
 		for (int i = 0; i < rows(); ++i) 
 			for (int j = 0; j < cols(); ++j) 
-				if (m[i][j] == tEMP) m[i][j] = wALL;
+				if (m[i][j] == tEMP) set_cell(i, j, wALL);
 	}
 
 
-  // Mark all cells reachable by a unit from (i, j).
-  void traversal(int i, int j, vector<vector<bool>>& mkd) {
-    if (not mkd[i][j]) {
-      mkd[i][j] = true;
+  // Marks in the scratch grid the cells reachable by a unit from (i, j),
+  // and returns how many of them are not walls. Stops as soon as n such
+  // cells are found.
+  int traversal(int i, int j, int n) {
+    new_generation();
+    vector<Pos>& st = stack_;
+    st.clear();
+    st.push_back({i, j});
+    mark(i, j);
+    int cnt = 0;
+    while (not st.empty() and cnt < n) {
+      Pos p = st.back();
+      st.pop_back();
+      if (m[p.i][p.j] != wALL) ++cnt;
       for (int k = 0; k < 4; ++k) {
-        int ii = i + DIRI4[k];
-        int jj = j + DIRJ4[k];
-        if (inside(ii, jj) and m[ii][jj] != wALL)
-          traversal(ii, jj, mkd);
+        int ii = p.i + DIRI4[k];
+        int jj = p.j + DIRJ4[k];
+        if (inside(ii, jj) and m[ii][jj] != wALL and not marked(ii, jj)) {
+          mark(ii, jj);
+          st.push_back({ii, jj});
+        }
       }
     }
+    return cnt;
   }
 
 
-  // Returns whether a unit reach all cells without water.
-  bool is_connected() {
-    vector<vector<bool>> mkd(rows(), vector<bool>(cols(), false));
-    traversal(rows()/2, cols()/2, mkd);
+  // Returns whether the cells next to c, which have just become walls,
+  // still reach each other without leaving the box around c widened by
+  // WALL_CHECK_MARGIN. Old cities count as walls. If so, any way through
+  // c can go around it, so a connected board remains connected.
+  bool keeps_connected(const vector<Pos>& c) {
+    const int M = WALL_CHECK_MARGIN;
+    Box b = {rows(), cols(), 0, 0};
+    for (auto x : c)
+      b = {min(b.i0, x.i-M), min(b.j0, x.j-M), max(b.i1, x.i+M+1), max(b.j1, x.j+M+1)};
+    b = intersection(b, {0, 0, rows(), cols()});
+
+    auto open = [&](int i, int j) {
+      return i >= b.i0 and i < b.i1 and j >= b.j0 and j < b.j1
+         and m[i][j] != wALL and m[i][j] != tEMP;
+    };
+
+    vector<Pos> side;
+    for (auto x : c)
+      for (int k = 0; k < 4; ++k)
+        if (open(x.i + DIRI4[k], x.j + DIRJ4[k]))
+          side.push_back({x.i + DIRI4[k], x.j + DIRJ4[k]});
+    if (side.empty()) return true;
+
+    new_generation();
+    vector<Pos>& st = stack_;
+    st.clear();
+    st.push_back(side[0]);
+    mark(side[0].i, side[0].j);
+    while (not st.empty()) {
+      Pos p = st.back();
+      st.pop_back();
+      for (int k = 0; k < 4; ++k) {
+        int ii = p.i + DIRI4[k];
+        int jj = p.j + DIRJ4[k];
+        if (open(ii, jj) and not marked(ii, jj)) {
+          mark(ii, jj);
+          st.push_back({ii, jj});
+        }
+      }
+    }
+    for (auto x : side)
+      if (not marked(x.i, x.j)) return false;
+    return true;
+  }
 
-    for (int i = 0; i < rows(); ++i)
-      for (int j = 0; j < cols(); ++j)
-        if (m[i][j] != wALL and not mkd[i][j])
-          return false;
 
-    return true;
+  // Returns whether a unit reach all cells without water.
+  bool is_connected() {
+    int n = rows()*cols() - count(wALL, {0, 0, rows(), cols()});
+    return traversal(rows()/2, cols()/2, n) == n;
   }
 
   bool valid() {
@@ -589,11 +896,47 @@ class Board : public Info, public Random_generator {
   
 public:
 
+  /**
+   * Revision of the text format of games. In format 1 every round repeats
+   * the cities and the paths, while in format 2 they are printed once,
+   * after the names of the players, preceded by a line "format 2".
+   */
+  static const int FORMAT = 2;
+
+  /**
+   * Sets the number of threads for speculative board generation
+   * (GENERATOR1 1). By default, or with 0, there is one per core.
+   */
+  static void set_generator_threads (int n);
+
   /**
    * Construct a board by reading information from a stream.
    */
   Board (istream& is, int seed);
 
+  /**
+   * Construct a board from the information of a game already started.
+   */
+  Board (const Info& info, int seed);
+
+  /**
+   * Marks the current board so that it can be restored later with
+   * rollback(). Checkpoints can be nested, and should be set between
+   * rounds. While there is some checkpoint, all changes are recorded.
+   */
+  void checkpoint ();
+
+  /**
+   * Restores the board as it was at the last checkpoint, and removes it.
+   * Takes time proportional to the number of changes since then.
+   */
+  void rollback ();
+
+  /**
+   * Removes the last checkpoint, keeping the changes made since then.
+   */
+  void commit ();
+
   /**
    * Returns the name of a player.
    */
@@ -606,16 +949,25 @@ public:
    * Prints the board settings to a stream.
    */
   void print_settings (ostream& os) const;
+  void print_settings (Writer& w) const;
 
   /**
    * Prints the name players to a stream.
    */
   void print_names (ostream& os) const;
+  void print_names (Writer& w) const;
+
+  /**
+   * Prints the cities and the paths to a stream.
+   */
+  void print_static (Writer& w) const;
 
   /**
-   * Prints the state of the board to a stream.
+   * Prints the state of the board to a stream. The cities and the paths
+   * are only included if statics is set (format 1 of games).
    */
   void print_state (ostream& os) const;
+  void print_state (Writer& w, bool statics = true) const;
 
   /**
    * Prints the results and the names of the winning players.
@@ -627,6 +979,7 @@ public:
    * It also prints to os the actual actions performed.
    */
   void next (const vector<Action>& act, ostream& os);
+  void next (const vector<Action>& act, Writer& w);
 
 };
 
@@ -1,53 +1,88 @@
 #include "Game.hh"
 
 
-void Game::run (vector<string> names, istream& is, ostream& os, int seed) {
-  cerr << "info: seed " << seed << endl;
+void Game::run (vector<string> names, istream& is, ostream& os, int seed,
+                bool binary, int format, ostream* index) {
+  _my_assert(format >= 1 and format <= Board::FORMAT, "Wrong format.");
 
-  cerr << "info: loading game" << endl;
+  _log(LOG_INFO, LOG_GAME, "seed " << seed);
+
+  _log(LOG_INFO, LOG_GAME, "loading game");
   Board b(is, seed);
-  cerr << "info: loaded game" << endl;
+  _log(LOG_INFO, LOG_GAME, "loaded game");
 
   int np = b.nb_players();
   int nr = b.nb_rounds();
 
   _my_assert(np == (int)names.size(), "Wrong number of players.");
 
+  // A player may end up owning every unit, and may repeat some commands.
+  Action::max_commands_ = max(Action::MAX_COMMANDS, 2*b.nb_players()*b.nb_units());
+
   vector<Player*> players;
   for (int pl = 0; pl < np; ++pl) {
     string name = names[pl];
     b.names_[pl] = name;
-    cerr << "info: loading player " << name << endl;
+    _log(LOG_INFO, LOG_GAME, "loading player " << name);
     players.push_back(Registry::new_player(name));
     players[pl]->me_ = pl;
     players[pl]->set_random_seed(seed + pl + 1);
     *static_cast<Settings*>(players[pl]) = (Settings)b;
   }
-  cerr << "info: players loaded" << endl;
+  _log(LOG_INFO, LOG_GAME, "players loaded");
 
-  os << "Game" << endl << endl;
-  os << "Seed " << seed << endl << endl;
-  b.print_settings(os);
-  b.print_names(os);
-  b.print_state(os);
+  Writer w(os);
+  ReplayWriter replay(os);
+  RoundIndex offsets;
+  if (binary) replay.start(b, seed);
+  else {
+    w << "Game\n\n";
+    w << "Seed " << seed << "\n\n";
+    b.print_settings(w);
+    b.print_names(w);
+    if (format >= 2) {
+      w << "format " << format << '\n';
+      b.print_static(w);
+    }
+    offsets.add(-1, w.offset());
+    b.print_state(w, format == 1);
+    w.flush();
+  }
 
   for (int round = 0; round < nr; ++round) {
-    cerr << "info: start round " << round << endl;
+    _log(LOG_DEBUG, LOG_ROUND, "start round " << round);
     vector<Action> actions(np);
     for (int pl = 0; pl < np; ++pl) {
-      cerr << "info:     start player " << pl << endl;
+      _log(LOG_DEBUG, LOG_ROUND, "    start player " << pl);
       players[pl]->reset(b);
       players[pl]->play();
       actions[pl] = *players[pl];
-      cerr << "info:     end player " << pl << endl;
+      _log(LOG_DEBUG, LOG_ROUND, "    end player " << pl);
     }
 
-    b.next(actions, os);
-    b.print_state(os);
-    cerr << "info: end round " << round << endl;
+    if (binary) {
+      vector<Command> done;
+      b.apply(actions, done);
+      _my_assert(b.ok(), "Invariants are not satisfied.");
+      replay.round(b, done);
+    }
+    else {
+      long long commands = w.offset();
+      b.next(actions, w);
+      offsets.add(commands, w.offset());
+      b.print_state(w, format == 1);
+      w.flush();
+    }
+    _log(LOG_DEBUG, LOG_ROUND, "end round " << round);
   }
 
+  if (binary) replay.finish();
+  else if (index) {
+    offsets.finish(w.offset());
+    offsets.write(*index);
+  }
   b.print_results();
 
-  cerr << "info: game played" << endl;
+  _log(LOG_INFO, LOG_GAME, "game played");
+  Log::summary();
 }
@@ -4,6 +4,8 @@
 
 #include "Player.hh"
 #include "Board.hh"
+#include "Replay.hh"
+#include "RoundIndex.hh"
 
 
 /**
@@ -13,7 +15,15 @@ class Game {
 
 public:
 
-  static void run (vector<string> names, istream& is, ostream& os, int seed);
+  /**
+   * Plays a game, writing it to os in the given revision of the text
+   * format, or in the binary replay format if binary is set.
+   * In the text format, the offsets of the rounds are written to index
+   * if it is not null.
+   */
+  static void run (vector<string> names, istream& is, ostream& os, int seed,
+                   bool binary = false, int format = Board::FORMAT,
+                   ostream* index = 0);
 
 };
 
@@ -39,7 +39,7 @@ bool Info::ok() {
       }
   
   // grid_[i][j].type == CITY iff grid_[i][j].city_id != -1
-  map<int, int> cnt_cities;
+  vector<int> cnt_cities(city_.size(), 0);
   for (int i = 0; i < rows(); ++i)
     for (int j = 0; j < cols(); ++j) {
       CellType t = grid_[i][j].type;
@@ -54,6 +54,11 @@ bool Info::ok() {
              << "has valid city identifier" << endl;
         return false;
       }
+      if (id >= int(city_.size())) {
+        cerr << "error: cell at position " << Pos(i, j)
+             << "has a city identifier out of range" << endl;
+        return false;
+      }
       if (id != -1) ++cnt_cities[id];
     }
 
@@ -72,7 +77,7 @@ bool Info::ok() {
   }
 
   // grid_[i][j].type == PATH iff grid_[i][j].path_id != -1
-  map<int,int> cnt_paths;
+  vector<int> cnt_paths(path_.size(), 0);
   for (int i = 0; i < rows(); ++i)
     for (int j = 0; j < cols(); ++j) {
       CellType t = grid_[i][j].type;
@@ -87,6 +92,11 @@ bool Info::ok() {
              << "has valid path identifier" << endl;
         return false;
       }
+      if (id >= int(path_.size())) {
+        cerr << "error: cell at position " << Pos(i, j)
+             << "has a path identifier out of range" << endl;
+        return false;
+      }
       if (id != -1) ++cnt_paths[id];
     }
 
@@ -174,10 +184,10 @@ bool Info::ok() {
     }
   }
 
-  set<int> all;
+  vector<bool> all(total_units(), false);
+  int cnt_all = 0;
   for (int pl = 0; pl < nb_players(); ++pl)
     for (int id : pl_units_[pl]) {
-      all.insert(id);
       if (not unit_ok(id)) {
         cerr << "error: mismatch with players (1)" << endl;
         return false;
@@ -186,8 +196,12 @@ bool Info::ok() {
         cerr << "error: mismatch with players (2)" << endl;
         return false;
       }
+      if (not all[id]) {
+        all[id] = true;
+        ++cnt_all;
+      }
     }
-  if (int(all.size ()) != total_units()) {
+  if (cnt_all != total_units()) {
     cerr << "error: number of units does not match" << endl;
     return false;
   }
@@ -216,3 +230,74 @@ bool Info::ok() {
   
   return true;
 }
+
+
+void Info::read_state (Tokenizer& t) {
+
+  // Should read what Board::print_state() prints.
+  // Should fill the same data structures as
+  // Board::Board (istream& is, int seed), except for settings and names.
+
+  // In format 2, cities and paths are only sent once, before the grid
+  // of the first state. In format 1, they follow the grid of every state.
+  if (t.peek() == 'c') read_cities_and_paths(t);
+  read_rows(t);
+  if (t.peek() == 'c') read_cities_and_paths(t);
+  _my_assert(not city_.empty(), "Expected 'cities' while parsing.");
+  set_city_and_path_ids();
+  read_masks(t);
+
+  Token s = t.next();
+  _my_assert(s == "round", "Expected 'round' while parsing. Found " + s.str());
+  round_ = t.next_int();
+  _my_assert(round_ >= 0 and round_ <= nb_rounds(), "Round is not ok.");
+
+  _my_assert(t.next() == "total_score", "Expected 'total_score' while parsing.");
+  total_score_ = vector<int>(nb_players());
+  for (auto& ts : total_score_) {
+    ts = t.next_int();
+    _my_assert(ts >= 0, "Total score cannot be negative.");
+  }
+
+  _my_assert(t.next() == "status", "Expected 'status' while parsing.");
+  cpu_status_ = vector<double>(nb_players());
+  for (auto& st : cpu_status_) {
+    st = t.next_double();
+    _my_assert(st == -1 or (st >= 0 and st <= 1), "Status is not ok.");
+  }
+
+  _my_assert(t.next() == "city_owners", "Expected 'city_owners' while parsing.");
+  city_owner_ = vector<int>(nb_cities());
+  for (int& co : city_owner_) {
+    co = t.next_int();
+    _my_assert(co == -1 or (co >= 0 and co <= nb_players()), "City owner is not ok.");
+  }
+
+  _my_assert(t.next() == "path_owners", "Expected 'path_owners' while parsing.");
+  path_owner_ = vector<int>(nb_paths());
+  for (int& po : path_owner_) {
+    po = t.next_int();
+    _my_assert(po == -1 or (po >= 0 and po <= nb_players()), "Path owner is not ok.");
+  }
+
+  _my_assert(t.next() == "units", "Expected 'units' while parsing.");
+
+  unit_ = vector<Unit>( nb_players() * nb_units() );
+  pl_units_= vector< vector<int> >(nb_players());
+
+  for (int id = 0; id < nb_players() * nb_units(); ++id) {
+    int pl, i, j, h, d, tu, imm, m;
+    bool read = t.read_int(pl) and t.read_int(i) and t.read_int(j) and t.read_int(h)
+            and t.read_int(d) and t.read_int(tu) and t.read_int(imm) and t.read_int(m);
+    _my_assert(read, "Could not read info for unit " + int_to_string(id) + ".");
+    _my_assert(pos_ok(i, j), "Position is not ok.");
+    _my_assert(cell(i, j).type != WALL, "Cell should be wall.");
+    _my_assert(cell(i, j).unit_id == -1, "Cell should not have any unit.");
+    _my_assert(h >= 0, "Health should be non-negative");
+    grid_[i][j].unit_id = id;
+    unit_[id] = Unit(id, pl, Pos(i, j), h, d, tu, imm, m);
+    pl_units_[pl].push_back(id);
+  }
+
+  _my_assert(ok(), "Invariants are not satisfied.");
+}
@@ -26,17 +26,28 @@ public:
    * Reads the grid of the board.
    * Should fill the same data structures as a board generator.
    */
-  void read_grid (istream& is) {
-    string l;
-    is >> l; // Read 1st line of column labels.
-    is >> l; // Read 2nd line of column labels.
-    grid_ = vector< vector<Cell> >(rows(), vector<Cell>(cols()));
+  void read_grid (Tokenizer& t) {
+    read_rows(t);
+    read_cities_and_paths(t);
+    set_city_and_path_ids();
+    read_masks(t);
+  }
+
+  /**
+   * Reads the rows of the grid, with their labels.
+   */
+  void read_rows (Tokenizer& t) {
+    t.next(); // Read 1st line of column labels.
+    t.next(); // Read 2nd line of column labels.
+    if (int(grid_.size()) == rows() and int(grid_[0].size()) == cols())
+      for (auto& row : grid_) fill(row.begin(), row.end(), Cell());
+    else grid_ = vector< vector<Cell> >(rows(), vector<Cell>(cols()));
     for (int i = 0; i < rows(); ++i) {
-      string s;
-      is >> l >> s;
-      // Read row label in l and row in s.
-      _my_assert((int)s.size() == cols(),
+      t.next(); // Read row label.
+      Token row = t.next();
+      _my_assert(row.n == cols(),
                  "The read map has a line with incorrect length.");
+      const char* s = row.s;
       for (int j = 0; j < cols(); ++j){
 	if (s[j] >= 'a' and s[j] <= 'd') {
 	  grid_[i][j].type  = GRASS;
@@ -54,34 +65,43 @@ public:
 	  grid_[i][j].type = char2CellType(s[j]);
       }
     }
+  }
 
-    int nb_cities_;
-    is >> l >> nb_cities_;
-    _my_assert(l == "cities", "Expected 'cities'.");
+  /**
+   * Reads the cities and the paths, which are fixed during the whole game.
+   */
+  void read_cities_and_paths (Tokenizer& t) {
+    _my_assert(t.next() == "cities", "Expected 'cities'.");
+    int nb_cities_ = t.next_int();
     city_ = vector<City>(nb_cities_);
     for (auto& x : city_) {
-      int sz;
-      is >> sz;
-      x = City(sz);
+      x = City(t.next_int());
       for (Pos& p : x) {
-        is >> p.i >> p.j;
+        p.i = t.next_int();
+        p.j = t.next_int();
         _my_assert(pos_ok(p), "Position of city is not ok.");
       }
     }
-    int nb_paths_;
-    is >> l >> nb_paths_;
-    _my_assert(l == "paths", "Expected 'paths'.");
+    _my_assert(t.next() == "paths", "Expected 'paths'.");
+    int nb_paths_ = t.next_int();
     path_ = vector<Path>(nb_paths_);
     for (auto& x : path_) {
-      int a, b, sz;
-      is >> a >> b >> sz;
+      int a  = t.next_int();
+      int b  = t.next_int();
+      int sz = t.next_int();
       x = {{a, b}, vector<Pos>(sz)};
       for (Pos& p : x.second) {
-        is >> p.i >> p.j;
+        p.i = t.next_int();
+        p.j = t.next_int();
         _my_assert(pos_ok(p), "Position of path is not ok.");
       }
     }
+  }
 
+  /**
+   * Stores the ids of the cities and paths in the cells of the grid.
+   */
+  void set_city_and_path_ids () {
     for (int k = 0; k < int(city_.size()); ++k)
       for (auto x: city_[k]) {
         _my_assert(grid_[x.i][x.j].type == CITY, "Should be city.");
@@ -93,18 +113,31 @@ public:
         _my_assert(grid_[x.i][x.j].type == PATH, "Should be path.");
         grid_[x.i][x.j].path_id = k;
       }
-    
-    int nb_masks_;
-    is >> l >> nb_masks_;
-    _my_assert(l == "masks", "Expected 'masks'.");
+  }
+
+  /**
+   * Reads the masks and marks them in the cells of the grid.
+   */
+  void read_masks (Tokenizer& t) {
+    _my_assert(t.next() == "masks", "Expected 'masks'.");
+    int nb_masks_ = t.next_int();
     masks_ = vector<Pos>(nb_masks_);
     for (auto& p : masks_){
-      is >> p.i >> p.j;
+      p.i = t.next_int();
+      p.j = t.next_int();
       _my_assert(pos_ok(p), "Position of mask is not ok.");
       _my_assert(grid_[p.i][p.j].type == GRASS, "Should be grass.");
       grid_[p.i][p.j].mask = true;
     }
-  }  
+  }
+
+  /**
+   * Reads a state as printed by Board::print_state, in any format.
+   * In format 2, cities and paths are read if they come before the grid,
+   * and otherwise should be known already.
+   */
+  void read_state (Tokenizer& t);
+
   /**
    * Checks invariants are preserved.
    */
@@ -0,0 +1,153 @@
+#include "Board.hh"
+
+
+/*! \file
+ * Test of the undo journal of Board: plays games with random commands,
+ * rolls back nested checkpoints and checks that the whole board is
+ * exactly as it was when each checkpoint was set.
+ */
+
+
+class JournalCheck {
+
+public:
+
+  /**
+   * Returns an empty string if a and b match, otherwise what differs.
+   */
+  static string differences (const Board& a, const Board& b) {
+    ostringstream oss;
+    if (a.round_ != b.round_) oss << "round ";
+    if (a.total_score_ != b.total_score_) oss << "scores ";
+    if (a.cpu_status_ != b.cpu_status_) oss << "cpu status ";
+    if (a.rnd_seed != b.rnd_seed) oss << "random seed ";
+    for (int k = 0; k < a.nb_cities(); ++k)
+      if (a.city_owner_[k] != b.city_owner_[k]) oss << "owner of city " << k << ' ';
+    for (int k = 0; k < a.nb_paths(); ++k)
+      if (a.path_owner_[k] != b.path_owner_[k]) oss << "owner of path " << k << ' ';
+    for (int id = 0; id < a.total_units(); ++id) {
+      const Unit& u = a.unit_[id];
+      const Unit& v = b.unit_[id];
+      if (u.id != v.id or u.player != v.player or u.pos != v.pos or
+          u.health != v.health or u.damage != v.damage or u.turns != v.turns or
+          u.immune != v.immune or u.mask != v.mask)
+        oss << "unit " << id << ' ';
+    }
+    for (int pl = 0; pl < a.nb_players(); ++pl)
+      if (a.pl_units_[pl] != b.pl_units_[pl]) oss << "units of " << pl << ' ';
+    if (a.masks_ != b.masks_) oss << "masks ";
+    for (int i = 0; i < a.rows(); ++i)
+      for (int j = 0; j < a.cols(); ++j) {
+        const Cell& c = a.grid_[i][j];
+        const Cell& d = b.grid_[i][j];
+        if (c.type != d.type or c.unit_id != d.unit_id or c.virus != d.virus or
+            c.mask != d.mask or c.city_id != d.city_id or c.path_id != d.path_id)
+          oss << "cell " << Pos(i, j) << ' ';
+      }
+    return oss.str();
+  }
+
+  /**
+   * Returns whether b still has some checkpoint.
+   */
+  static bool journaling (const Board& b) {
+    return b.journaling();
+  }
+
+};
+
+
+/**
+ * Plays a round with mostly valid random commands, plus a few wrong ones.
+ */
+void play (Board& b) {
+  int np = b.nb_players();
+  int nu = b.total_units();
+  vector<Action> act(np);
+  for (int id = 0; id < nu; ++id)
+    if (rand() % 8) {
+      int pl = rand() % 20 ? b.unit(id).player : rand() % np;
+      act[pl].move(rand() % 50 ? id : nu + rand() % 3, Dir(rand() % DIR_SIZE));
+    }
+  ostringstream os;
+  b.next(act, os);
+}
+
+
+/**
+ * Plays up to n rounds, without going beyond the end of the game.
+ */
+void play (Board& b, int n) {
+  for (int k = 0; k < n and b.round() < b.nb_rounds(); ++k) play(b);
+}
+
+
+int main (int argc, char** argv) {
+  if (argc < 3) {
+    cout << "Usage: " << argv[0] << " first_seed nb_seeds [< default.cnf]" << endl;
+    return EXIT_SUCCESS;
+  }
+  int first = string_to_int(argv[1]);
+  int n     = string_to_int(argv[2]);
+
+  ostringstream cnf;
+  cnf << cin.rdbuf();
+
+  int failed = 0;
+  for (int seed = first; seed < first + n; ++seed) {
+    istringstream is(cnf.str());
+    Board b(is, seed);
+    srand(seed);
+
+    string diff;
+    int checks = 0;
+    auto check = [&](const Board& expected, const string& what) {
+      string d = JournalCheck::differences(b, expected);
+      if (not d.empty() and diff.empty())
+        diff = what + " at round " + int_to_string(expected.round()) + ": " + d;
+      ++checks;
+    };
+
+    while (b.round() < b.nb_rounds() and diff.empty()) {
+      // Nested checkpoints: the inner one is rolled back or committed,
+      // and then the outer one is always rolled back.
+      Board outer = b;
+      b.checkpoint();
+      play(b, 1 + rand() % 5);
+
+      Board inner = b;
+      bool keep = rand() % 2;
+      b.checkpoint();
+      play(b, 1 + rand() % 5);
+      if (keep) b.commit();
+      else {
+        b.rollback();
+        check(inner, "inner rollback");
+      }
+
+      play(b, rand() % 3);
+      b.rollback();
+      check(outer, "outer rollback");
+      if (JournalCheck::journaling(b)) diff = "checkpoints left ";
+
+      // The board must go on exactly as the copy, both without
+      // checkpoints and after committing all changes.
+      int k = 1 + rand() % 5;
+      unsigned int r = rand();
+      srand(r);
+      play(outer, k);
+      srand(r);
+      b.checkpoint();
+      play(b, k);
+      b.commit();
+      check(outer, "commit");
+    }
+    if (diff.empty())
+      cout << "seed " << seed << ": ok (" << checks << " checks)" << endl;
+    else {
+      cout << "seed " << seed << ": mismatch after " << diff << endl;
+      ++failed;
+    }
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+#include <chrono>
+#include <thread>
+
+#include "Log.hh"
+
+
+atomic<int> Log::level_(LOG_INFO);
+
+
+namespace {
+
+  const char* level_name[LOG_LEVEL_SIZE] = { "error", "warning", "info", "debug" };
+
+  const char* category_name[LOG_CATEGORY_SIZE] = { "game", "round", "query", "command", "tool" };
+
+
+  /**
+   * Bounded queue for several producers and one consumer, without locks:
+   * every slot has a sequence number telling whether it can be written or
+   * read in the current lap (after D. Vyukov's bounded MPMC queue).
+   */
+  class Queue {
+
+  public:
+
+    Queue (int size) : slot_(size), mask_(size - 1), head_(0), tail_(0) {
+      _my_assert(size > 0 and (size & (size - 1)) == 0, "Size must be a power of 2.");
+      for (int k = 0; k < size; ++k) slot_[k].seq.store(k, memory_order_relaxed);
+    }
+
+    // Returns false if the queue is full.
+    bool push (string& msg) {
+      long long pos = tail_.load(memory_order_relaxed);
+      while (true) {
+        Slot& s = slot_[pos & mask_];
+        long long d = s.seq.load(memory_order_acquire) - pos;
+        if (d == 0) {
+          if (tail_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+            s.msg.swap(msg);
+            s.seq.store(pos + 1, memory_order_release);
+            return true;
+          }
+        }
+        else if (d < 0) return false;
+        else pos = tail_.load(memory_order_relaxed);
+      }
+    }
+
+    // Returns false if the queue is empty. Only called by the consumer.
+    bool pop (string& msg) {
+      long long pos = head_.load(memory_order_relaxed);
+      Slot& s = slot_[pos & mask_];
+      if (s.seq.load(memory_order_acquire) - (pos + 1) < 0) return false;
+      msg.swap(s.msg);
+      s.msg.clear();
+      head_.store(pos + 1, memory_order_relaxed);
+      s.seq.store(pos + mask_ + 1, memory_order_release);
+      return true;
+    }
+
+  private:
+
+    struct Slot {
+      atomic<long long> seq;
+      string            msg;
+    };
+
+    vector<Slot>        slot_;
+    long long           mask_;
+    atomic<long long>   head_;
+    atomic<long long>   tail_;
+
+  };
+
+
+  /**
+   * The queue, the writer thread and the counters.
+   */
+  class Logger {
+
+  public:
+
+    Logger () : rate_(100), queue_(1 << 14), pushed_(0), written_(0), stop_(false) {
+      for (int c = 0; c < LOG_CATEGORY_SIZE; ++c) {
+        window_[c] = -1;
+        count_[c] = 0;
+        suppressed_[c] = 0;
+      }
+      thread_ = thread(&Logger::run, this);
+    }
+
+    ~Logger () {
+      stop_ = true;
+      thread_.join();
+    }
+
+    static Logger& get () {
+      static Logger logger;
+      return logger;
+    }
+
+    // The message is not counted against the rate if limited is false.
+    void write (LogLevel level, LogCategory cat, const string& msg, bool limited = true) {
+      if (limited and not admit(cat)) return;
+      string line = string(level_name[level]) + ": " + msg + '\n';
+      if (level == LOG_ERROR) {
+        flush();
+        cerr << line;
+        cerr.flush();
+      }
+      else if (queue_.push(line)) ++pushed_;
+      else ++suppressed_[cat];
+    }
+
+    void flush () {
+      while (written_.load() != pushed_.load()) this_thread::yield();
+    }
+
+    atomic<int>       rate_;
+    atomic<long long> suppressed_[LOG_CATEGORY_SIZE];
+
+  private:
+
+    Queue             queue_;
+    atomic<long long> window_[LOG_CATEGORY_SIZE]; // Second of the current count.
+    atomic<int>       count_[LOG_CATEGORY_SIZE];  // Messages in the current second.
+    atomic<long long> pushed_;
+    atomic<long long> written_;
+    atomic<bool>      stop_;
+    thread            thread_;
+
+    // Counts the message and returns whether it is within the rate.
+    // The window may be reset twice by concurrent threads; it does not matter.
+    bool admit (LogCategory cat) {
+      int rate = rate_.load(memory_order_relaxed);
+      if (rate == 0) return true;
+      long long now = chrono::duration_cast<chrono::seconds>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+      if (window_[cat].load(memory_order_relaxed) != now) {
+        window_[cat].store(now, memory_order_relaxed);
+        count_[cat].store(0, memory_order_relaxed);
+      }
+      if (++count_[cat] <= rate) return true;
+      ++suppressed_[cat];
+      return false;
+    }
+
+    // Writes the queued messages, sleeping a little when there are none.
+    void run () {
+      string msg;
+      int idle = 0;
+      while (true) {
+        if (queue_.pop(msg)) {
+          cerr << msg;
+          ++written_;
+          idle = 0;
+        }
+        else if (stop_ and written_.load() == pushed_.load()) break;
+        else {
+          if (idle++ == 0) cerr.flush();
+          if (idle < 64) this_thread::yield();
+          else this_thread::sleep_for(chrono::microseconds(500));
+        }
+      }
+      cerr.flush();
+    }
+
+  };
+
+}
+
+
+void Log::set_level (LogLevel level) {
+  _my_assert(level >= 0 and level < LOG_LEVEL_SIZE, "Wrong log level.");
+  level_ = level;
+}
+
+
+void Log::set_rate (int rate) {
+  _my_assert(rate >= 0, "Wrong log rate.");
+  Logger::get().rate_ = rate;
+}
+
+
+void Log::write (LogLevel level, LogCategory cat, const string& msg) {
+  // The progress and results of the game are output, not chatter: they
+  // grow with the number of players but are never rate limited.
+  if (enabled(level)) Logger::get().write(level, cat, msg, cat != LOG_GAME);
+}
+
+
+long long Log::suppressed (LogCategory cat) {
+  return Logger::get().suppressed_[cat];
+}
+
+
+void Log::flush () {
+  Logger::get().flush();
+}
+
+
+void Log::summary () {
+  for (int c = 0; c < LOG_CATEGORY_SIZE; ++c) {
+    long long n = suppressed(LogCategory(c));
+    if (n > 0 and enabled(LOG_INFO)) {
+      ostringstream oss;
+      oss << n << " message(s) of category " << category_name[c] << " suppressed";
+      Logger::get().write(LOG_INFO, LOG_GAME, oss.str(), false);
+    }
+  }
+  flush();
+}
+
+
+LogLevel Log::string_to_level (const string& s) {
+  for (int l = 0; l < LOG_LEVEL_SIZE; ++l)
+    if (s == level_name[l]) return LogLevel(l);
+  _my_assert(false, "Unknown log level " + s + ".");
+  return LOG_INFO;
+}
+
+
+void assertion_failed (const string& msg) {
+  // Not rate limited, whatever the level: the program is about to abort.
+  Logger::get().write(LOG_ERROR, LOG_GAME, msg, false);
+}
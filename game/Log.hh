@@ -0,0 +1,131 @@
+#ifndef Log_hh
+#define Log_hh
+
+
+#include <atomic>
+
+#include "Utils.hh"
+
+
+/** \file
+ * Contains a logging facility with levels, per-category rate limits and
+ * counters. Messages are written to cerr by a background thread, so that
+ * logging does not slow down the game.
+ */
+
+
+/**
+ * Levels of the messages, from the most to the least important.
+ */
+enum LogLevel {
+  LOG_ERROR,
+  LOG_WARNING,
+  LOG_INFO,
+  LOG_DEBUG,
+  LOG_LEVEL_SIZE
+};
+
+
+/**
+ * Categories of the messages, each one but LOG_GAME with its own rate limit.
+ */
+enum LogCategory {
+  LOG_GAME,    // Progress and results of the game, never rate limited.
+  LOG_ROUND,   // Progress of every round.
+  LOG_QUERY,   // Bad queries to the state of the game.
+  LOG_COMMAND, // Wrong or repeated commands.
+  LOG_TOOL,    // Other programs.
+  LOG_CATEGORY_SIZE
+};
+
+
+/**
+ * Static class for logging.
+ *
+ * Messages of a level above the current one are discarded without being
+ * formatted. Messages of a category beyond its rate (per second) are
+ * counted but not written. Errors are written at once, after the pending
+ * messages; the rest are queued and written by a background thread.
+ * Failed _my_assert are written as errors too, so no message is lost.
+ */
+class Log {
+
+public:
+
+  /**
+   * Sets the level of the messages to be written (LOG_INFO by default).
+   */
+  static void set_level (LogLevel level);
+
+  /**
+   * Returns the level of the messages to be written.
+   */
+  static LogLevel level ();
+
+  /**
+   * Returns whether messages of the given level are written.
+   */
+  static bool enabled (LogLevel level);
+
+  /**
+   * Sets the maximum number of messages per second of every category
+   * but LOG_GAME (100 by default, 0 for no limit).
+   */
+  static void set_rate (int rate);
+
+  /**
+   * Writes a message, which should not end with a newline.
+   */
+  static void write (LogLevel level, LogCategory cat, const string& msg);
+
+  /**
+   * Returns the number of messages of a category that were not written
+   * because of the rate limit or because the queue was full.
+   */
+  static long long suppressed (LogCategory cat);
+
+  /**
+   * Waits until the pending messages are written.
+   */
+  static void flush ();
+
+  /**
+   * Writes, at the info level, how many messages of every category
+   * were suppressed, if any. These lines are not rate limited.
+   */
+  static void summary ();
+
+  /**
+   * Parses the name of a level ("error", "warning", "info", "debug").
+   */
+  static LogLevel string_to_level (const string& s);
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  static atomic<int> level_;
+
+};
+
+
+inline LogLevel Log::level () {
+  return LogLevel(level_.load(memory_order_relaxed));
+}
+
+inline bool Log::enabled (LogLevel level) {
+  return level <= Log::level();
+}
+
+
+/**
+ * Logs a message built with operator <<, e.g.
+ * _log(LOG_WARNING, LOG_QUERY, "unit requested for identifier " << id).
+ * Nothing is evaluated if the level is not enabled.
+ */
+#define _log(level, cat, s) { if (Log::enabled(level)) { ostringstream _oss; _oss << s; Log::write(level, cat, _oss.str()); } }
+
+
+#endif
@@ -1,4 +1,5 @@
 #include "Game.hh"
+#include "MapCache.hh"
 
 
 void help (int argc, char** argv) {
@@ -7,6 +8,15 @@ void help (int argc, char** argv) {
   cout << "--seed=seed     -s seed     set random seed"                   << endl;
   cout << "--input=file    -i input    set input file  (default: stdin)"  << endl;
   cout << "--output=file   -o output   set output file (default: stdout)" << endl;
+  cout << "--format=n      -f n        set text format (default: " << Board::FORMAT << ")"  << endl;
+  cout << "--binary        -b          write a binary replay"             << endl;
+  cout << "--to-text       -t          convert a binary replay to text"   << endl;
+  cout << "--index=file    -x file     write the index of the rounds"     << endl;
+  cout << "--make-index    -m          write the index of a text game"    << endl;
+  cout << "--map-cache=dir -c dir      reuse generated maps stored in dir" << endl;
+  cout << "--gen-threads=n -g n        set threads for speculative generation (GENERATOR1 1; default: one per core)" << endl;
+  cout << "--log-level=l   -L level    set log level: error, warning, info, debug (default: info)" << endl;
+  cout << "--log-rate=n    -r n        set log messages per second and category (default: 100, 0: no limit)" << endl;
   cout << "--list          -l          list registered players"           << endl;
   cout << "--version       -v          print version"                     << endl;
   cout << "--help          -h          print help"                        << endl;
@@ -20,23 +30,37 @@ int main (int argc, char** argv) {
   }
 
   struct option long_options[] = {
-    { "seed",    required_argument, 0, 's' },
-    { "input",   required_argument, 0, 'i' },
-    { "output",  required_argument, 0, 'o' },
-    { "list",    no_argument,       0, 'l' },
-    { "version", no_argument,       0, 'v' },
-    { "help",    no_argument,       0, 'h' },
+    { "seed",        required_argument, 0, 's' },
+    { "input",       required_argument, 0, 'i' },
+    { "output",      required_argument, 0, 'o' },
+    { "format",      required_argument, 0, 'f' },
+    { "binary",      no_argument,       0, 'b' },
+    { "to-text",     no_argument,       0, 't' },
+    { "index",       required_argument, 0, 'x' },
+    { "make-index",  no_argument,       0, 'm' },
+    { "map-cache",   required_argument, 0, 'c' },
+    { "gen-threads", required_argument, 0, 'g' },
+    { "log-level",   required_argument, 0, 'L' },
+    { "log-rate",    required_argument, 0, 'r' },
+    { "list",        no_argument,       0, 'l' },
+    { "version",     no_argument,       0, 'v' },
+    { "help",        no_argument,       0, 'h' },
     { 0, 0, 0, 0 }
   };
 
   char* ifile = 0;
   char* ofile = 0;
   int seed = -1;
+  int format = Board::FORMAT;
+  bool binary = false;
+  bool to_text = false;
+  bool make_index = false;
+  char* xfile = 0;
   vector<string> names;
 
   while (true) {
     int index = 0;
-    int c = getopt_long(argc, argv, "s:i:o:lvh", long_options, &index);
+    int c = getopt_long(argc, argv, "s:i:o:f:btx:mc:g:L:r:lvh", long_options, &index);
     if (c == -1) break;
 
     switch (c) {
@@ -49,6 +73,33 @@ int main (int argc, char** argv) {
       case 'o':
         ofile = optarg;
         break;
+      case 'f':
+        format = string_to_int(optarg);
+        break;
+      case 'b':
+        binary = true;
+        break;
+      case 't':
+        to_text = true;
+        break;
+      case 'x':
+        xfile = optarg;
+        break;
+      case 'm':
+        make_index = true;
+        break;
+      case 'c':
+        MapCache::set_directory(optarg);
+        break;
+      case 'g':
+        Board::set_generator_threads(string_to_int(optarg));
+        break;
+      case 'L':
+        Log::set_level(Log::string_to_level(optarg));
+        break;
+      case 'r':
+        Log::set_rate(string_to_int(optarg));
+        break;
       case 'l':
         Registry::print_players(cout);
         return EXIT_SUCCESS;
@@ -69,13 +120,23 @@ int main (int argc, char** argv) {
     _my_assert(names.back().size() <= 12, "Player name too long.");
   }
 
-  _my_assert(seed >= 0, "Missing seed?");
+  if (not to_text and not make_index) _my_assert(seed >= 0, "Missing seed?");
+  _my_assert(not xfile or not (binary or to_text or make_index),
+             "The index of the rounds (-x) is only written when playing a text game.");
 
-  istream* is = ifile ? new ifstream(ifile) : &cin;
-  ostream* os = ofile ? new ofstream(ofile) : &cout;
+  istream* is = ifile ? new ifstream(ifile, ios::binary) : &cin;
+  ostream* os = ofile ? new ofstream(ofile, ios::binary) : &cout;
 
-  Game::run(names, *is, *os, seed);
+  ostream* xs = xfile ? new ofstream(xfile) : 0;
+
+  if (to_text) ReplayReader::to_text(*is, *os, format);
+  else if (make_index) {
+    string text((istreambuf_iterator<char>(*is)), istreambuf_iterator<char>());
+    RoundIndex::scan(text.data(), text.size()).write(*os);
+  }
+  else Game::run(names, *is, *os, seed, binary, format, xs);
 
+  if (xfile) delete xs;
   if (ifile) delete is;
   if (ofile) delete os;
 }
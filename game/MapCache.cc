@@ -0,0 +1,245 @@
+#include <unistd.h>
+
+#include "MapCache.hh"
+
+
+const char MapCache::MAGIC[] = "PNDM";
+
+string MapCache::dir_;
+
+
+namespace {
+
+  /**
+   * Reads the numbers of a map file. Any error makes ok false.
+   */
+  struct Input {
+
+    const string& s;
+    size_t        p;
+    bool         ok;
+
+    int u8 () {
+      if (p >= s.size()) {
+        ok = false;
+        return 0;
+      }
+      return (unsigned char)s[p++];
+    }
+
+    unsigned long long varint () {
+      unsigned long long x = 0;
+      for (int sh = 0; ok and sh < 64; sh += 7) {
+        int c = u8();
+        x |= (unsigned long long)(c & 0x7F) << sh;
+        if (not (c & 0x80)) return x;
+      }
+      ok = false;
+      return 0;
+    }
+
+    long long svarint () {
+      unsigned long long x = varint();
+      return (long long)(x >> 1) ^ -(long long)(x & 1);
+    }
+
+    // Reads a count, which must be at most n.
+    int size (int n) {
+      unsigned long long x = varint();
+      if (x > (unsigned long long)n) ok = false;
+      return ok ? int(x) : 0;
+    }
+
+  };
+
+
+  void varint (string& s, unsigned long long x) {
+    while (x >= 0x80) {
+      s += char(x | 0x80);
+      x >>= 7;
+    }
+    s += char(x);
+  }
+
+  void svarint (string& s, long long x) {
+    varint(s, (unsigned long long)(x << 1) ^ (unsigned long long)(x >> 63));
+  }
+
+
+  /**
+   * Returns whether the cells of the cities and the paths have the right
+   * type, are not shared, and are all the city and path cells of the
+   * grid, and whether paths join two different cities. Board assumes all
+   * of it, and asserts some.
+   */
+  bool consistent (const vector< vector<Cell> >& grid,
+                   const vector<State::City>& city,
+                   const vector<State::Path>& path) {
+    int rows = grid.size();
+    int cols = grid[0].size();
+    vector<char> used(rows*cols, false);
+    int cells = 0;
+    for (const auto& c : city) {
+      if (c.empty()) return false;
+      for (Pos p : c) {
+        if (grid[p.i][p.j].type != CITY or used[p.i*cols + p.j]) return false;
+        used[p.i*cols + p.j] = true;
+        ++cells;
+      }
+    }
+    for (const auto& x : path) {
+      int a = x.first.first;
+      int b = x.first.second;
+      if (a >= int(city.size()) or b >= int(city.size()) or a == b) return false;
+      for (Pos p : x.second) {
+        if (grid[p.i][p.j].type != PATH or used[p.i*cols + p.j]) return false;
+        used[p.i*cols + p.j] = true;
+        ++cells;
+      }
+    }
+    for (int i = 0; i < rows; ++i)
+      for (int j = 0; j < cols; ++j) {
+        CellType t = grid[i][j].type;
+        if (t == CITY or t == PATH) --cells;
+        bool border = i == 0 or j == 0 or i == rows-1 or j == cols-1;
+        if (border and t != WALL) return false;
+      }
+    return cells == 0;
+  }
+
+}
+
+
+void MapCache::set_directory (const string& dir) {
+  dir_ = dir;
+}
+
+
+const string& MapCache::directory () {
+  return dir_;
+}
+
+
+bool MapCache::enabled () {
+  return not dir_.empty();
+}
+
+
+string MapCache::file (const string& key) {
+  // FNV-1a. Collisions are detected because the key is stored in the file.
+  unsigned long long h = 14695981039346656037ULL;
+  for (char c : key) {
+    h ^= (unsigned char)c;
+    h *= 1099511628211ULL;
+  }
+  ostringstream oss;
+  oss << dir_ << '/' << hex << setw(16) << setfill('0') << h << ".map";
+  return oss.str();
+}
+
+
+bool MapCache::load (const string& key, Board& b, long long& seed) {
+  ifstream ifs(file(key), ios::binary);
+  if (not ifs) return false;
+  string s((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+
+  Input in{s, 0, true};
+  for (int k = 0; k < 4; ++k)
+    if (in.u8() != MAGIC[k]) return false;
+  if (in.varint() != FORMAT) return false;
+  int n = in.size(s.size());
+  if (not in.ok or s.compare(in.p, n, key) != 0) return false;
+  in.p += n;
+
+  // The file is the one of the key: from here on, errors are reported.
+  auto damaged = [&]() {
+    _log(LOG_WARNING, LOG_GAME, "damaged map cache file " << file(key) << ", generating the map");
+    return false;
+  };
+  seed = in.svarint();
+
+  int rows = b.rows();
+  int cols = b.cols();
+  vector< vector<Cell> > grid(rows, vector<Cell>(cols));
+  for (int i = 0; i < rows; ++i)
+    for (int j = 0; j < cols; ++j) {
+      char c = in.u8();
+      if (c != wALL and c != gRASS and c != cITY and c != pATH) return damaged();
+      grid[i][j].type = char2CellType(c);
+    }
+
+  // Positions are checked, so that a damaged file cannot break the board.
+  auto pos = [&](Pos& p) {
+    p.i = in.svarint();
+    p.j = in.svarint();
+    if (p.i < 0 or p.i >= rows or p.j < 0 or p.j >= cols) in.ok = false;
+  };
+
+  vector<State::City> city(in.size(rows*cols));
+  for (auto& c : city) {
+    c = State::City(in.size(rows*cols));
+    for (Pos& p : c) pos(p);
+  }
+  vector<State::Path> path(in.size(rows*cols));
+  for (auto& x : path) {
+    int a  = in.size(city.size());
+    int c  = in.size(city.size());
+    x = {{a, c}, vector<Pos>(in.size(rows*cols))};
+    for (Pos& p : x.second) pos(p);
+  }
+  if (not in.ok or in.p != s.size()) return damaged();
+  if (not consistent(grid, city, path)) return damaged();
+
+  b.grid_.swap(grid);
+  b.city_.swap(city);
+  b.path_.swap(path);
+  b.set_city_and_path_ids();
+  return true;
+}
+
+
+void MapCache::save (const string& key, const Board& b, long long seed) {
+  string s(MAGIC, 4);
+  varint(s, FORMAT);
+  varint(s, key.size());
+  s += key;
+  svarint(s, seed);
+
+  for (int i = 0; i < b.rows(); ++i)
+    for (int j = 0; j < b.cols(); ++j)
+      s += CellType2char(b.grid_[i][j].type);
+
+  varint(s, b.city_.size());
+  for (const auto& c : b.city_) {
+    varint(s, c.size());
+    for (Pos p : c) {
+      svarint(s, p.i);
+      svarint(s, p.j);
+    }
+  }
+  varint(s, b.path_.size());
+  for (const auto& x : b.path_) {
+    varint(s, x.first.first);
+    varint(s, x.first.second);
+    varint(s, x.second.size());
+    for (Pos p : x.second) {
+      svarint(s, p.i);
+      svarint(s, p.j);
+    }
+  }
+
+  string name = file(key);
+  string tmp = name + '.' + int_to_string(getpid());
+  {
+    ofstream ofs(tmp, ios::binary);
+    ofs.write(s.data(), s.size());
+    if (not ofs) {
+      _log(LOG_WARNING, LOG_GAME, "could not write map cache file " << tmp);
+      return;
+    }
+  }
+  if (rename(tmp.c_str(), name.c_str()) != 0) {
+    _log(LOG_WARNING, LOG_GAME, "could not write map cache file " << name);
+    remove(tmp.c_str());
+  }
+}
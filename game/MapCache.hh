@@ -0,0 +1,81 @@
+#ifndef MapCache_hh
+#define MapCache_hh
+
+
+#include "Board.hh"
+
+
+/*! \file
+ * Contains a cache on disk of the maps made by the board generators, so
+ * that games with the same seed and settings do not generate them again.
+ *
+ * Every map is stored in its own file, named after a hash of its key.
+ * Integers are LEB128 varints (signed ones zigzag-encoded), as in the
+ * binary replays. A file consists of the magic "PNDM", the format, the
+ * key, the state of the random generator after the generation, and the
+ * map: cell types (one char per cell), cities and paths.
+ */
+
+
+/**
+ * Static class to store and retrieve generated maps.
+ *
+ * The key of a map is made of all the settings, the generator line and
+ * the state of the random generator before the generation, so that a
+ * game on a cached map is identical to one on a generated map.
+ */
+class MapCache {
+
+public:
+
+  static const char MAGIC[];
+  static const int  FORMAT = 1;
+
+  /**
+   * Sets the directory of the cache, which must exist. The cache is not
+   * used if the directory is empty, as by default.
+   */
+  static void set_directory (const string& dir);
+
+  /**
+   * Returns the directory of the cache.
+   */
+  static const string& directory ();
+
+  /**
+   * Returns whether the cache is used.
+   */
+  static bool enabled ();
+
+  /**
+   * Reads the map with the given key into b (its grid, cities and paths),
+   * and the state of the random generator after generating it into
+   * seed. Returns false if the map is not in the cache, or if its file
+   * is damaged: then the map must be generated again.
+   */
+  static bool load (const string& key, Board& b, long long& seed);
+
+  /**
+   * Stores the map of b with the given key. The file is written under
+   * another name and then renamed, so concurrent games never read half
+   * a map.
+   */
+  static void save (const string& key, const Board& b, long long seed);
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  static string dir_;
+
+  /**
+   * Returns the name of the file of the given key.
+   */
+  static string file (const string& key);
+
+};
+
+
+#endif
@@ -49,6 +49,7 @@ private:
   }
 
   void reset (ifstream& is);
+  void reset (Tokenizer& t);
   
 };
 
@@ -31,6 +31,10 @@ private:
   friend class Board;
   friend class Game;
   friend class SecGame;
+  friend class Simulation;
+  friend class JournalCheck;
+  friend class Rollout;
+  friend class SimBoard;
 
   static const long long RANDOM_MOD = ((long long)1)<<31;
   static const long long RANDOM_MASK = RANDOM_MOD - 1;
@@ -0,0 +1,504 @@
+#include "Replay.hh"
+
+
+const char ReplayWriter::MAGIC[] = "PNDB";
+
+
+ReplayWriter::ReplayWriter (ostream& os, int keyframe_interval) :
+  os_(os), interval_(keyframe_interval), offset_(0) {
+  _my_assert(interval_ >= 1, "Wrong interval of keyframes.");
+}
+
+
+void ReplayWriter::u8 (int x) {
+  buf_.push_back(char(x));
+}
+
+
+void ReplayWriter::varint (unsigned long long x) {
+  while (x >= 0x80) {
+    buf_.push_back(char(x | 0x80));
+    x >>= 7;
+  }
+  buf_.push_back(char(x));
+}
+
+
+void ReplayWriter::svarint (long long x) {
+  varint((unsigned long long)(x << 1) ^ (unsigned long long)(x >> 63));
+}
+
+
+void ReplayWriter::f64 (double x) {
+  unsigned long long y;
+  memcpy(&y, &x, sizeof(y));
+  for (int k = 0; k < 8; ++k) u8(int(y >> (8*k)) & 0xFF);
+}
+
+
+void ReplayWriter::pos (Pos p) {
+  svarint(p.i);
+  svarint(p.j);
+}
+
+
+void ReplayWriter::unit (const Unit& u) {
+  svarint(u.player);
+  pos(u.pos);
+  svarint(u.health);
+  svarint(u.damage);
+  svarint(u.turns);
+  u8(u.immune);
+  u8(u.mask);
+}
+
+
+void ReplayWriter::flush () {
+  os_.write(buf_.data(), buf_.size());
+  offset_ += buf_.size();
+  buf_.clear();
+}
+
+
+void ReplayWriter::start (const Board& b, int seed) {
+  for (int k = 0; k < 4; ++k) u8(MAGIC[k]);
+  varint(FORMAT);
+  svarint(seed);
+
+  varint(b.nb_players());
+  varint(b.rows());
+  varint(b.cols());
+  varint(b.nb_rounds());
+  varint(b.initial_health());
+  varint(b.nb_units());
+  varint(b.bonus_per_city_cell());
+  varint(b.bonus_per_path_cell());
+  varint(b.factor_connected_component());
+  f64(b.infection_factor());
+  f64(b.mask_protection());
+
+  for (int i = 0; i < b.rows(); ++i)
+    for (int j = 0; j < b.cols(); ++j)
+      u8(CellType2char(b.grid_[i][j].type));
+
+  varint(b.city_.size());
+  for (const auto& c : b.city_) {
+    varint(c.size());
+    for (Pos p : c) pos(p);
+  }
+  varint(b.path_.size());
+  for (const auto& p : b.path_) {
+    varint(p.first.first);
+    varint(p.first.second);
+    varint(p.second.size());
+    for (Pos x : p.second) pos(x);
+  }
+
+  for (const string& name : b.names_) {
+    varint(name.size());
+    for (char c : name) u8(c);
+  }
+
+  varint(interval_);
+  flush();
+
+  frame(b, vector<Command>());
+}
+
+
+void ReplayWriter::round (const Board& b, const vector<Command>& done) {
+  frame(b, done);
+}
+
+
+void ReplayWriter::frame (const Board& b, const vector<Command>& done) {
+  int r = b.round();
+  bool key = r % interval_ == 0;
+  if (key) keyframes_.push_back(offset_);
+
+  u8(key ? 'K' : 'D');
+  varint(r);
+
+  if (r > 0) {
+    varint(done.size());
+    for (Command c : done) {
+      varint(c.id);
+      u8(Action::d2c(c.dir));
+    }
+  }
+
+  // Changed elements are identified by the gap with the previous one.
+  vector<int> changed;
+
+  int n = b.rows() * b.cols();
+  if (key) {
+    virus_ = vector<int>(n);
+    for (int i = 0; i < b.rows(); ++i)
+      for (int j = 0; j < b.cols(); ++j) {
+        virus_[i*b.cols() + j] = b.grid_[i][j].virus;
+        varint(b.grid_[i][j].virus);
+      }
+  }
+  else {
+    for (int i = 0; i < b.rows(); ++i)
+      for (int j = 0; j < b.cols(); ++j)
+        if (b.grid_[i][j].virus != virus_[i*b.cols() + j])
+          changed.push_back(i*b.cols() + j);
+    varint(changed.size());
+    int last = -1;
+    for (int k : changed) {
+      virus_[k] = b.grid_[k / b.cols()][k % b.cols()].virus;
+      varint(k - last - 1);
+      varint(virus_[k]);
+      last = k;
+    }
+  }
+
+  varint(b.masks_.size());
+  for (Pos p : b.masks_) pos(p);
+
+  if (key) score_ = vector<int>(b.nb_players(), 0);
+  for (int pl = 0; pl < b.nb_players(); ++pl) {
+    svarint(b.total_score_[pl] - score_[pl]);
+    score_[pl] = b.total_score_[pl];
+  }
+
+  if (key) {
+    for (double st : b.cpu_status_) f64(st);
+  }
+  else if (status_ != b.cpu_status_) {
+    u8(1);
+    for (double st : b.cpu_status_) f64(st);
+  }
+  else u8(0);
+  status_ = b.cpu_status_;
+
+  for (int t = 0; t < 2; ++t) {
+    const vector<int>& now  = t == 0 ? b.city_owner_ : b.path_owner_;
+    vector<int>&       prev = t == 0 ? city_owner_   : path_owner_;
+    if (key) {
+      for (int o : now) svarint(o);
+    }
+    else {
+      changed.clear();
+      for (int k = 0; k < int(now.size()); ++k)
+        if (now[k] != prev[k]) changed.push_back(k);
+      varint(changed.size());
+      int last = -1;
+      for (int k : changed) {
+        varint(k - last - 1);
+        svarint(now[k]);
+        last = k;
+      }
+    }
+    prev = now;
+  }
+
+  if (key) {
+    for (const Unit& u : b.unit_) unit(u);
+  }
+  else {
+    changed.clear();
+    for (int id = 0; id < b.total_units(); ++id) {
+      const Unit& u = b.unit_[id];
+      const Unit& v = unit_[id];
+      if (u.player != v.player or u.pos != v.pos or u.health != v.health or
+          u.damage != v.damage or u.turns != v.turns or
+          u.immune != v.immune or u.mask != v.mask)
+        changed.push_back(id);
+    }
+    varint(changed.size());
+    int last = -1;
+    for (int id : changed) {
+      varint(id - last - 1);
+      unit(b.unit_[id]);
+      last = id;
+    }
+  }
+  unit_ = b.unit_;
+
+  flush();
+}
+
+
+void ReplayWriter::finish () {
+  long long footer = offset_;
+  u8('E');
+  varint(keyframes_.size());
+  for (long long k : keyframes_) varint(k);
+  for (int k = 0; k < 4; ++k) u8(int(footer >> (8*k)) & 0xFF);
+  flush();
+  os_.flush();
+}
+
+
+// ***************************************************************************
+
+
+namespace {
+
+  int get_u8 (istream& is) {
+    int c = is.get();
+    _my_assert(c != EOF, "Unexpected end of binary replay.");
+    return c;
+  }
+
+  unsigned long long get_varint (istream& is) {
+    unsigned long long x = 0;
+    for (int s = 0; ; s += 7) {
+      int c = get_u8(is);
+      x |= (unsigned long long)(c & 0x7F) << s;
+      if (not (c & 0x80)) return x;
+    }
+  }
+
+  long long get_svarint (istream& is) {
+    unsigned long long x = get_varint(is);
+    return (long long)(x >> 1) ^ -(long long)(x & 1);
+  }
+
+  double get_f64 (istream& is) {
+    unsigned long long y = 0;
+    for (int k = 0; k < 8; ++k) y |= (unsigned long long)get_u8(is) << (8*k);
+    double x;
+    memcpy(&x, &y, sizeof(x));
+    return x;
+  }
+
+  Pos get_pos (istream& is) {
+    int i = get_svarint(is);
+    int j = get_svarint(is);
+    return Pos(i, j);
+  }
+
+}
+
+
+int ReplayReader::u8 () {
+  return get_u8(is_);
+}
+
+
+unsigned long long ReplayReader::varint () {
+  return get_varint(is_);
+}
+
+
+long long ReplayReader::svarint () {
+  return get_svarint(is_);
+}
+
+
+double ReplayReader::f64 () {
+  return get_f64(is_);
+}
+
+
+Pos ReplayReader::pos () {
+  return get_pos(is_);
+}
+
+
+Unit ReplayReader::unit (int id) {
+  int pl = svarint();
+  Pos p  = pos();
+  int h  = svarint();
+  int d  = svarint();
+  int t  = svarint();
+  int im = u8();
+  int m  = u8();
+  return Unit(id, pl, p, h, d, t, im, m);
+}
+
+
+Info ReplayReader::read_header (istream& is, int& seed) {
+  for (int k = 0; k < 4; ++k)
+    _my_assert(get_u8(is) == ReplayWriter::MAGIC[k], "Not a binary replay.");
+  _my_assert(int(get_varint(is)) == ReplayWriter::FORMAT,
+             "Unsupported format of binary replay.");
+  seed = get_svarint(is);
+
+  Info info;
+  info.nb_players_                 = get_varint(is);
+  info.rows_                       = get_varint(is);
+  info.cols_                       = get_varint(is);
+  info.nb_rounds_                  = get_varint(is);
+  info.initial_health_             = get_varint(is);
+  info.nb_units_                   = get_varint(is);
+  info.bonus_per_city_cell_        = get_varint(is);
+  info.bonus_per_path_cell_        = get_varint(is);
+  info.factor_connected_component_ = get_varint(is);
+  info.infection_factor_           = get_f64(is);
+  info.mask_protection_            = get_f64(is);
+
+  info.grid_ = vector<vector<Cell>>(info.rows(), vector<Cell>(info.cols()));
+  for (int i = 0; i < info.rows(); ++i)
+    for (int j = 0; j < info.cols(); ++j) {
+      Cell& c = info.grid_[i][j];
+      c.type    = char2CellType(get_u8(is));
+      c.unit_id = -1;
+      c.virus   = 0;
+      c.mask    = false;
+    }
+
+  info.city_ = vector<State::City>(get_varint(is));
+  for (int k = 0; k < int(info.city_.size()); ++k) {
+    info.city_[k] = State::City(get_varint(is));
+    for (Pos& p : info.city_[k]) {
+      p = get_pos(is);
+      info.grid_[p.i][p.j].city_id = k;
+    }
+  }
+  info.path_ = vector<State::Path>(get_varint(is));
+  for (int k = 0; k < int(info.path_.size()); ++k) {
+    State::Path& path = info.path_[k];
+    path.first.first  = get_varint(is);
+    path.first.second = get_varint(is);
+    path.second = vector<Pos>(get_varint(is));
+    for (Pos& p : path.second) {
+      p = get_pos(is);
+      info.grid_[p.i][p.j].path_id = k;
+    }
+  }
+
+  info.round_       = 0;
+  info.total_score_ = vector<int>   (info.nb_players(), 0);
+  info.cpu_status_  = vector<double>(info.nb_players(), 0);
+  info.city_owner_  = vector<int>(info.city_.size(), -1);
+  info.path_owner_  = vector<int>(info.path_.size(), -1);
+  info.unit_        = vector<Unit>(info.nb_players() * info.nb_units());
+  info.pl_units_    = vector<vector<int>>(info.nb_players());
+  return info;
+}
+
+
+ReplayReader::ReplayReader (istream& is) :
+  is_(is), seed_(0), board_(read_header(is, seed_), 0) {
+  for (string& name : board_.names_) {
+    name = string(varint(), ' ');
+    for (char& c : name) c = u8();
+  }
+  varint(); // Interval of keyframes, only useful for seeking.
+  _my_assert(is_.peek() == 'K', "Missing initial keyframe.");
+  frame();
+}
+
+
+bool ReplayReader::next () {
+  int tag = is_.peek();
+  if (tag == EOF or tag == 'E') return false;
+  frame();
+  return true;
+}
+
+
+void ReplayReader::frame () {
+  Board& b = board_;
+  int tag = u8();
+  _my_assert(tag == 'K' or tag == 'D', "Wrong frame of binary replay.");
+  bool key = tag == 'K';
+
+  b.round_ = varint();
+
+  commands_.clear();
+  if (b.round_ > 0) {
+    for (int cnt = varint(); cnt > 0; --cnt) {
+      int id = varint();
+      commands_.push_back(Command(id, Action::c2d(u8())));
+    }
+  }
+
+  if (key) {
+    for (int i = 0; i < b.rows(); ++i)
+      for (int j = 0; j < b.cols(); ++j)
+        b.grid_[i][j].virus = varint();
+  }
+  else {
+    int k = -1;
+    for (int cnt = varint(); cnt > 0; --cnt) {
+      k += varint() + 1;
+      b.grid_[k / b.cols()][k % b.cols()].virus = varint();
+    }
+  }
+
+  for (Pos p : b.masks_) b.grid_[p.i][p.j].mask = false;
+  b.masks_.resize(varint());
+  for (Pos& p : b.masks_) {
+    p = pos();
+    b.grid_[p.i][p.j].mask = true;
+  }
+
+  for (int pl = 0; pl < b.nb_players(); ++pl) {
+    if (key) b.total_score_[pl] = 0;
+    b.total_score_[pl] += svarint();
+  }
+
+  if (key or u8())
+    for (double& st : b.cpu_status_) st = f64();
+
+  for (vector<int>* owner : {&b.city_owner_, &b.path_owner_}) {
+    if (key) {
+      for (int& o : *owner) o = svarint();
+    }
+    else {
+      int k = -1;
+      for (int cnt = varint(); cnt > 0; --cnt) {
+        k += varint() + 1;
+        (*owner)[k] = svarint();
+      }
+    }
+  }
+
+  vector<Unit>& changed = changed_;
+  changed.clear();
+  if (key) {
+    for (int id = 0; id < b.total_units(); ++id) changed.push_back(unit(id));
+  }
+  else {
+    int id = -1;
+    for (int cnt = varint(); cnt > 0; --cnt) {
+      id += varint() + 1;
+      changed.push_back(unit(id));
+    }
+  }
+  // Units are first removed from their old cells, as they may swap places.
+  for (const Unit& u : changed) {
+    Pos p = b.unit_[u.id].pos;
+    if (b.pos_ok(p) and b.grid_[p.i][p.j].unit_id == u.id)
+      b.grid_[p.i][p.j].unit_id = -1;
+  }
+  for (const Unit& u : changed) {
+    b.unit_[u.id] = u;
+    if (b.pos_ok(u.pos)) b.grid_[u.pos.i][u.pos.j].unit_id = u.id;
+  }
+
+  if (not changed.empty()) {
+    for (auto& v : b.pl_units_) v.clear();
+    for (const Unit& u : b.unit_) b.pl_units_[u.player].push_back(u.id);
+  }
+}
+
+
+void ReplayReader::to_text (istream& is, ostream& os, int format) {
+  _my_assert(format >= 1 and format <= Board::FORMAT, "Wrong format.");
+  ReplayReader r(is);
+  const Board& b = r.board();
+  Writer w(os);
+
+  w << "Game\n\n";
+  w << "Seed " << r.seed() << "\n\n";
+  b.print_settings(w);
+  b.print_names(w);
+  if (format >= 2) {
+    w << "format " << format << '\n';
+    b.print_static(w);
+  }
+  b.print_state(w, format == 1);
+
+  while (r.next()) {
+    w << "commands\n";
+    Action::print(r.commands(), w);
+    b.print_state(w, format == 1);
+  }
+  w.flush();
+}
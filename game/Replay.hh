@@ -0,0 +1,169 @@
+#ifndef Replay_hh
+#define Replay_hh
+
+
+#include "Board.hh"
+
+
+/*! \file
+ * Contains the classes to write and read games in the binary replay format,
+ * and to convert them to the text format.
+ *
+ * All numbers are little-endian. Integers are LEB128 varints (signed ones
+ * zigzag-encoded) and reals are IEEE doubles. A replay consists of:
+ *
+ *   - A header: magic "PNDB", format, seed, settings, the static map
+ *     (cell types, cities and paths), names of the players and the
+ *     interval between keyframes.
+ *   - One frame per round (round 0 included). Frames start with a tag,
+ *     'K' for keyframes and 'D' for deltas, the round and, except for round
+ *     0, the commands performed in that round. A keyframe then contains the
+ *     whole dynamic state (virus of every cell, masks, scores, status,
+ *     owners of cities and paths, units), while a delta contains only the
+ *     changes with respect to the previous frame.
+ *   - A footer: tag 'E', the number of keyframes and their offsets, and
+ *     finally the offset of the footer as a fixed 4-byte integer.
+ */
+
+
+/**
+ * Writes a game in the binary replay format while it is being played.
+ */
+class ReplayWriter {
+
+public:
+
+  static const char MAGIC[];
+  static const int  FORMAT = 1;
+
+  /**
+   * Constructor, given the output stream and the interval of keyframes.
+   */
+  ReplayWriter (ostream& os, int keyframe_interval = 20);
+
+  /**
+   * Writes the header and the initial state of the board.
+   */
+  void start (const Board& b, int seed);
+
+  /**
+   * Writes the state of the board after a round,
+   * and the commands performed in that round.
+   */
+  void round (const Board& b, const vector<Command>& done);
+
+  /**
+   * Writes the footer. Should be called once, at the end of the game.
+   */
+  void finish ();
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  ostream&          os_;
+  int         interval_;
+  long long     offset_; // Bytes written so far.
+  vector<char>     buf_; // Frame being written.
+  vector<long long> keyframes_;
+
+  // State of the previous frame.
+  vector<int>    virus_;
+  vector<int>    score_;
+  vector<double> status_;
+  vector<int>    city_owner_;
+  vector<int>    path_owner_;
+  vector<Unit>   unit_;
+
+  void u8      (int x);
+  void varint  (unsigned long long x);
+  void svarint (long long x);
+  void f64     (double x);
+  void pos     (Pos p);
+  void unit    (const Unit& u);
+  void flush   ();
+
+  void frame (const Board& b, const vector<Command>& done);
+
+};
+
+
+/**
+ * Reads a game in the binary replay format, round by round,
+ * into a board that can be printed in the text format.
+ */
+class ReplayReader {
+
+public:
+
+  /**
+   * Constructor, reads the header and the initial state from a stream.
+   */
+  ReplayReader (istream& is);
+
+  /**
+   * Returns the seed of the game.
+   */
+  int seed () const;
+
+  /**
+   * Returns the board with the state of the current round.
+   */
+  const Board& board () const;
+
+  /**
+   * Returns the commands performed in the current round.
+   */
+  const vector<Command>& commands () const;
+
+  /**
+   * Reads the next round. Returns false if there are no more rounds.
+   */
+  bool next ();
+
+  /**
+   * Converts a binary replay to the given revision of the text format
+   * of Game::run.
+   */
+  static void to_text (istream& is, ostream& os, int format = Board::FORMAT);
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  istream&             is_;
+  int                seed_;
+  Board               board_;
+  vector<Command> commands_;
+  vector<Unit>     changed_; // Units changed in the last frame.
+
+  int                u8 ();
+  unsigned long long varint ();
+  long long          svarint ();
+  double             f64 ();
+  Pos                pos ();
+  Unit               unit (int id);
+
+  static Info read_header (istream& is, int& seed);
+  void frame ();
+
+};
+
+
+inline int ReplayReader::seed () const {
+  return seed_;
+}
+
+inline const Board& ReplayReader::board () const {
+  return board_;
+}
+
+inline const vector<Command>& ReplayReader::commands () const {
+  return commands_;
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include "ReplayView.hh"
+
+
+namespace {
+
+  // Read-only stream buffer over a piece of memory.
+  struct MemoryBuffer : public streambuf {
+    MemoryBuffer (const char* data, size_t size) {
+      char* p = const_cast<char*>(data);
+      setg(p, p, p + size);
+    }
+  };
+
+  // Virus of a cell from its char in Board::print_state.
+  inline uint8_t virus_of (char c) {
+    if (c >= 'a' and c <= 'd') return c - 'a' + 1;
+    if (c >= 'A' and c <= 'J') return c - 'A' + 1;
+    if (c >= '0' and c <= '9') return c - '0' + 1;
+    return 0;
+  }
+
+}
+
+
+ReplayView::ReplayView (const string& file) :
+  file_(file), map_(new MappedFile(file)), seed_(0), start_(0),
+  text_(0), first_(true), buf_(0), bin_is_(0), bin_(0) {
+
+  binary_ = map_->size() >= 4 and memcmp(map_->data(), ReplayWriter::MAGIC, 4) == 0;
+  if (binary_) open_binary();
+  else open_text();
+
+  int np = info_.nb_players();
+  virus_      = vector<uint8_t>(info_.rows() * info_.cols());
+  score_      = vector<int>(np);
+  status_     = vector<double>(np);
+  city_owner_ = vector<int>(info_.nb_cities());
+  path_owner_ = vector<int>(info_.nb_paths());
+  units_      = vector<Unit>(info_.total_units());
+  commands_.reserve(info_.total_units());
+  view_.cols  = info_.cols();
+  view_.round = -1;
+  update_view();
+}
+
+
+ReplayView::~ReplayView () {
+  delete text_;
+  delete bin_;
+  delete bin_is_;
+  delete buf_;
+  delete map_;
+}
+
+
+void ReplayView::open_text () {
+  Tokenizer t(map_->data(), map_->size());
+
+  Token g = t.next();
+  _my_assert(g == "Game" or g == "SecGame", "Expected 'Game' while parsing.");
+  _my_assert(t.next() == "Seed", "Expected 'Seed' while parsing.");
+  seed_ = t.next_int();
+
+  *static_cast<Settings*>(&info_) = Settings::read_settings(t);
+
+  _my_assert(t.next() == "names", "Expected 'names' while parsing.");
+  names_ = vector<string>(info_.nb_players());
+  for (string& name : names_) name = t.next().str();
+
+  if (t.peek() == 'f') {
+    _my_assert(t.next() == "format", "Expected 'format' while parsing.");
+    int format = t.next_int();
+    _my_assert(format >= 2 and format <= Board::FORMAT, "Wrong format.");
+    info_.read_cities_and_paths(t);
+  }
+
+  start_ = t.offset();
+  info_.read_state(t);
+  rewind();
+}
+
+
+void ReplayView::open_binary () {
+  rewind();
+  info_ = bin_->board();
+  seed_ = bin_->seed();
+  for (int pl = 0; pl < info_.nb_players(); ++pl)
+    names_.push_back(bin_->board().name(pl));
+}
+
+
+void ReplayView::rewind () {
+  first_ = true;
+  if (binary_) {
+    delete bin_;
+    delete bin_is_;
+    delete buf_;
+    buf_    = new MemoryBuffer(map_->data(), map_->size());
+    bin_is_ = new istream(buf_);
+    bin_    = new ReplayReader(*bin_is_);
+  }
+  else {
+    delete text_;
+    text_ = new Tokenizer(map_->data() + start_, map_->size() - start_);
+  }
+}
+
+
+bool ReplayView::next () {
+  bool ok = binary_ ? next_binary() : next_text();
+  if (ok) update_view();
+  return ok;
+}
+
+
+bool ReplayView::next_text () {
+  Tokenizer& t = *text_;
+
+  commands_.clear();
+  if (first_) first_ = false;
+  else {
+    if (t.eof()) return false;
+    _my_assert(t.next() == "commands", "Expected 'commands' while parsing.");
+    int id;
+    char c;
+    while (t.read_int(id) and id != -1 and t.read_char(c))
+      commands_.push_back(Command(id, Action::c2d(c)));
+  }
+
+  int rows = info_.rows();
+  int cols = info_.cols();
+  t.next(); // 1st line of column labels.
+  t.next(); // 2nd line of column labels.
+  for (int i = 0; i < rows; ++i) {
+    t.next(); // Row label.
+    Token row = t.next();
+    _my_assert(row.n == cols, "The read map has a line with incorrect length.");
+    for (int j = 0; j < cols; ++j) virus_[i*cols + j] = virus_of(row.s[j]);
+  }
+
+  // In format 1, cities and paths are repeated, and skipped here.
+  if (t.peek() == 'c') {
+    _my_assert(t.next() == "cities", "Expected 'cities'.");
+    for (int k = t.next_int(); k > 0; --k)
+      for (int sz = t.next_int(); sz > 0; --sz) t.next(), t.next();
+    _my_assert(t.next() == "paths", "Expected 'paths'.");
+    for (int k = t.next_int(); k > 0; --k) {
+      t.next();
+      t.next();
+      for (int sz = t.next_int(); sz > 0; --sz) t.next(), t.next();
+    }
+  }
+
+  _my_assert(t.next() == "masks", "Expected 'masks'.");
+  masks_.resize(t.next_int());
+  for (Pos& p : masks_) {
+    p.i = t.next_int();
+    p.j = t.next_int();
+  }
+
+  _my_assert(t.next() == "round", "Expected 'round' while parsing.");
+  view_.round = t.next_int();
+
+  _my_assert(t.next() == "total_score", "Expected 'total_score' while parsing.");
+  for (int& ts : score_) ts = t.next_int();
+
+  _my_assert(t.next() == "status", "Expected 'status' while parsing.");
+  for (double& st : status_) st = t.next_double();
+
+  _my_assert(t.next() == "city_owners", "Expected 'city_owners' while parsing.");
+  for (int& co : city_owner_) co = t.next_int();
+
+  _my_assert(t.next() == "path_owners", "Expected 'path_owners' while parsing.");
+  for (int& po : path_owner_) po = t.next_int();
+
+  _my_assert(t.next() == "units", "Expected 'units' while parsing.");
+  for (int id = 0; id < int(units_.size()); ++id) {
+    int pl = t.next_int();
+    int i  = t.next_int();
+    int j  = t.next_int();
+    int h  = t.next_int();
+    int d  = t.next_int();
+    int tu = t.next_int();
+    int im = t.next_int();
+    int m  = t.next_int();
+    units_[id] = Unit(id, pl, Pos(i, j), h, d, tu, im, m);
+  }
+  return true;
+}
+
+
+bool ReplayView::next_binary () {
+  if (first_) first_ = false;
+  else if (not bin_->next()) return false;
+
+  const Board& b = bin_->board();
+  int cols = b.cols();
+  for (int i = 0; i < b.rows(); ++i)
+    for (int j = 0; j < cols; ++j)
+      virus_[i*cols + j] = b.grid_[i][j].virus;
+
+  masks_.assign(b.masks_.begin(), b.masks_.end());
+  view_.round = b.round();
+  copy(b.total_score_.begin(), b.total_score_.end(), score_.begin());
+  copy(b.cpu_status_.begin(),  b.cpu_status_.end(),  status_.begin());
+  copy(b.city_owner_.begin(),  b.city_owner_.end(),  city_owner_.begin());
+  copy(b.path_owner_.begin(),  b.path_owner_.end(),  path_owner_.begin());
+  copy(b.unit_.begin(),        b.unit_.end(),        units_.begin());
+  commands_.assign(bin_->commands().begin(), bin_->commands().end());
+  return true;
+}
+
+
+void ReplayView::update_view () {
+  view_.virus       = virus_.data();
+  view_.nb_masks    = masks_.size();
+  view_.masks       = masks_.data();
+  view_.total_score = score_.data();
+  view_.status      = status_.data();
+  view_.city_owner  = city_owner_.data();
+  view_.path_owner  = path_owner_.data();
+  view_.units       = units_.data();
+  view_.nb_commands = commands_.size();
+  view_.commands    = commands_.data();
+}
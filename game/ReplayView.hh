@@ -0,0 +1,205 @@
+#ifndef ReplayView_hh
+#define ReplayView_hh
+
+
+#include <cstdint>
+
+#include "Replay.hh"
+
+
+/*! \file
+ * Contains a library to go through the rounds of recorded games, either
+ * in the text format (any revision) or in the binary replay format.
+ */
+
+
+/**
+ * The state after a round, with the same fields as Board::print_state,
+ * plus the commands performed in that round. All arrays belong to the
+ * ReplayView and are overwritten when it moves to the next round.
+ */
+struct RoundView {
+
+  int round;
+
+  int cols;                   // Number of columns of the grid.
+  const uint8_t* virus;       // Virus of every cell, row by row.
+
+  int nb_masks;
+  const Pos* masks;           // Positions of the masks, as printed.
+
+  const int*    total_score;  // One per player.
+  const double* status;       // One per player.
+  const int*    city_owner;   // One per city.
+  const int*    path_owner;   // One per path.
+  const Unit*   units;        // All units, indexed by id.
+
+  int nb_commands;
+  const Command* commands;    // Commands performed (none in round 0).
+
+  /**
+   * Returns the virus of the cell (i, j).
+   */
+  inline int virus_at (int i, int j) const {
+    return virus[i*cols + j];
+  }
+
+};
+
+
+/**
+ * Reads a recorded game mapped in memory, round by round. The format is
+ * detected from the first bytes of the file. The arrays of the rounds
+ * are allocated once, when the game is opened.
+ *
+ * Usage:
+ *
+ *   ReplayView g("game.out");
+ *   for (const RoundView& r : g) ...
+ */
+class ReplayView {
+
+public:
+
+  /**
+   * Opens a game and reads its header.
+   */
+  ReplayView (const string& file);
+
+  ~ReplayView ();
+
+  /**
+   * Returns whether the game is in the binary replay format.
+   */
+  bool binary () const;
+
+  /**
+   * Returns the seed of the game.
+   */
+  int seed () const;
+
+  /**
+   * Returns the names of the players.
+   */
+  const vector<string>& names () const;
+
+  /**
+   * Returns the data that does not change during the game: settings,
+   * cell types, cities and paths (and the rest of the initial state).
+   */
+  const Info& map () const;
+
+  /**
+   * Moves to the next round (the first call gives round 0).
+   * Returns false if there are no more rounds.
+   */
+  bool next ();
+
+  /**
+   * Returns the current round.
+   */
+  const RoundView& round () const;
+
+  /**
+   * Goes back to the beginning of the game.
+   */
+  void rewind ();
+
+  /**
+   * Input iterator over the rounds, for range-based for loops.
+   * Calling begin() rewinds the game.
+   */
+  class iterator {
+  public:
+    inline iterator (ReplayView* g) : g_(g) { }
+    inline const RoundView& operator* () const { return g_->round(); }
+    inline const RoundView* operator-> () const { return &g_->round(); }
+    inline iterator& operator++ () {
+      if (not g_->next()) g_ = 0;
+      return *this;
+    }
+    inline bool operator!= (const iterator& it) const { return g_ != it.g_; }
+  private:
+    ReplayView* g_;
+  };
+
+  iterator begin ();
+  iterator end ();
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  string           file_;
+  MappedFile*       map_;
+  bool           binary_;
+  int              seed_;
+  vector<string>  names_;
+  Info             info_;
+
+  // Text format.
+  long long       start_; // Offset of the first state.
+  Tokenizer*       text_;
+  bool            first_; // Next round is round 0.
+
+  // Binary format.
+  streambuf*        buf_; // Over the mapped file.
+  istream*       bin_is_;
+  ReplayReader*     bin_;
+
+  // Current round.
+  RoundView           view_;
+  vector<uint8_t>    virus_;
+  vector<Pos>        masks_;
+  vector<int>        score_;
+  vector<double>    status_;
+  vector<int>   city_owner_;
+  vector<int>   path_owner_;
+  vector<Unit>       units_;
+  vector<Command> commands_;
+
+  ReplayView (const ReplayView&);
+  ReplayView& operator= (const ReplayView&);
+
+  void open_text ();
+  void open_binary ();
+  bool next_text ();
+  bool next_binary ();
+  void update_view ();
+
+};
+
+
+inline bool ReplayView::binary () const {
+  return binary_;
+}
+
+inline int ReplayView::seed () const {
+  return seed_;
+}
+
+inline const vector<string>& ReplayView::names () const {
+  return names_;
+}
+
+inline const Info& ReplayView::map () const {
+  return info_;
+}
+
+inline const RoundView& ReplayView::round () const {
+  return view_;
+}
+
+inline ReplayView::iterator ReplayView::begin () {
+  rewind();
+  return next() ? iterator(this) : end();
+}
+
+inline ReplayView::iterator ReplayView::end () {
+  return iterator(0);
+}
+
+
+#endif
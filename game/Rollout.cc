@@ -0,0 +1,91 @@
+#include "Rollout.hh"
+
+#include <atomic>
+#include <thread>
+
+
+Rollout::Rollout (const Info& root, int pl, Policy policy) :
+  root_(root), pl_(pl), policy_(policy) {
+  _my_assert(root.player_ok(pl), "Player is not ok.");
+}
+
+
+int Rollout::derived_seed (int seed, int a, int b) {
+  // SplitMix64 finalizer over the three values.
+  unsigned long long z = (unsigned long long)(unsigned)seed;
+  z = z * 0x9E3779B97F4A7C15ULL + (unsigned)a;
+  z = z * 0x9E3779B97F4A7C15ULL + (unsigned)b;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return int(z & Random_generator::RANDOM_MASK);
+}
+
+
+int Rollout::playout (Simulation& sim, Random_generator& rng, const Action& candidate,
+                      int rounds, int seed) const {
+  sim = root_; // Reuses the memory of the pooled simulation.
+  rng.set_random_seed(derived_seed(seed, -1, 0));
+  const Info& info = sim.info();
+  int np = info.nb_players();
+  for (int r = 0; r < rounds; ++r) {
+    for (int pl = 0; pl < np; ++pl)
+      if (r == 0 and pl == pl_) sim.action(pl) = candidate;
+      else policy_(info, pl, rng, sim.action(pl));
+    sim.next(derived_seed(seed, r, 1));
+  }
+  return info.total_score(pl_) - root_.info().total_score(pl_);
+}
+
+
+vector<Rollout::Result> Rollout::run (const vector<Action>& candidates, int playouts,
+                                      int rounds, int seed, int nb_threads) const {
+  _my_assert(playouts >= 1, "At least one playout is needed.");
+  const Info& root = root_.info();
+  rounds = max(0, min(rounds, root.nb_rounds() - root.round()));
+
+  int nc = candidates.size();
+  int nt = nc * playouts;
+  if (nb_threads <= 0) nb_threads = max(1u, thread::hardware_concurrency());
+  nb_threads = min(nb_threads, max(1, nt));
+
+  // Task t is playout t % playouts of candidate t / playouts. Each task has
+  // its own seed and result slot, so the thread running it does not matter.
+  vector<int> delta(nt);
+  atomic<int> next_task(0);
+  auto worker = [&] () {
+    Simulation sim = root_;
+    Random_generator rng;
+    for (int t = next_task++; t < nt; t = next_task++)
+      delta[t] = playout(sim, rng, candidates[t / playouts], rounds,
+                         derived_seed(seed, t / playouts, t % playouts));
+  };
+
+  vector<thread> pool;
+  for (int k = 1; k < nb_threads; ++k) pool.push_back(thread(worker));
+  worker();
+  for (thread& th : pool) th.join();
+
+  vector<Result> res(nc);
+  for (int c = 0; c < nc; ++c) {
+    // Welford's algorithm, in a fixed order.
+    double mean = 0, m2 = 0;
+    for (int k = 0; k < playouts; ++k) {
+      double x = delta[c*playouts + k];
+      double d = x - mean;
+      mean += d/(k + 1);
+      m2 += d*(x - mean);
+    }
+    res[c].playouts = playouts;
+    res[c].mean     = mean;
+    res[c].variance = playouts > 1 ? m2/(playouts - 1) : 0;
+  }
+  return res;
+}
+
+
+void Rollout::random_policy (const Info& info, int pl, Random_generator& rng, Action& act) {
+  for (int id = 0; id < info.total_units(); ++id)
+    if (info.unit(id).player == pl)
+      act.move(id, Dir(rng.random(0, DIR_SIZE - 1)));
+}
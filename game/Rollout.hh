@@ -0,0 +1,89 @@
+#ifndef Rollout_hh
+#define Rollout_hh
+
+
+#include <functional>
+
+#include "Simulation.hh"
+
+
+/*! \file
+ * Contains the Rollout class, to evaluate candidate actions of a player
+ * by means of many random playouts run in parallel.
+ */
+
+
+/**
+ * Runs playouts from a given state of the game. Each playout starts with
+ * one of the candidate actions for a player and continues for some rounds
+ * with a rollout policy for all players. Playouts are distributed among
+ * several threads, but results only depend on the given seed.
+ */
+class Rollout {
+
+public:
+
+  /**
+   * A rollout policy: fills act with the commands of player pl,
+   * given the current information of the simulated game.
+   * It is called from several threads at the same time, so it should
+   * only use the given random generator and no shared mutable data.
+   */
+  typedef function<void (const Info& info, int pl, Random_generator& rng, Action& act)> Policy;
+
+  /**
+   * Statistics of the score deltas obtained with a candidate action.
+   */
+  struct Result {
+    int    playouts; // Number of playouts.
+    double mean;     // Mean of the score deltas.
+    double variance; // Sample variance of the score deltas.
+  };
+
+  /**
+   * Constructor, given the state from which playouts start, the player
+   * whose candidate actions are evaluated, and the rollout policy.
+   */
+  Rollout (const Info& root, int pl, Policy policy);
+
+  /**
+   * Evaluates each of the candidate actions with the given number of
+   * playouts of (at most) the given number of rounds. The score delta of a
+   * playout is the final score of the player minus its score at the root.
+   * If nb_threads is 0, as many threads as cores are used.
+   */
+  vector<Result> run (const vector<Action>& candidates, int playouts,
+                      int rounds, int seed, int nb_threads = 0) const;
+
+  /**
+   * A simple rollout policy: every unit moves in a random direction.
+   */
+  static void random_policy (const Info& info, int pl, Random_generator& rng, Action& act);
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  Simulation root_;
+  int          pl_;
+  Policy   policy_;
+
+  /**
+   * Returns a seed in [0, 2^31) derived from the given values, so that
+   * different playouts and rounds use independent random streams.
+   */
+  static int derived_seed (int seed, int a, int b);
+
+  /**
+   * Runs one playout of the candidate in sim (which is overwritten),
+   * and returns the score delta.
+   */
+  int playout (Simulation& sim, Random_generator& rng, const Action& candidate,
+               int rounds, int seed) const;
+
+};
+
+
+#endif
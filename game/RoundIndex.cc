@@ -0,0 +1,119 @@
+#include "RoundIndex.hh"
+
+
+RoundIndex RoundIndex::scan (const char* data, size_t size) {
+  // Board::print_state starts with two empty lines followed by the column
+  // labels, indented by three spaces, which cannot be found elsewhere.
+  RoundIndex x;
+  long long commands = -1;
+  const char* end = data + size;
+  const char* p = data;
+  while ((p = (const char*)memchr(p, '\n', end - p)) != 0) {
+    ++p;
+    if (end - p >= 5 and memcmp(p, "\n\n   ", 5) == 0) {
+      x.add(commands, p - data);
+      commands = -1;
+      p += 2;
+    }
+    else if (end - p >= 9 and memcmp(p, "commands\n", 9) == 0)
+      commands = p - data;
+  }
+  x.finish(size);
+  return x;
+}
+
+
+RoundIndex RoundIndex::read (Tokenizer& t) {
+  _my_assert(t.next() == "states", "Expected 'states' while parsing.");
+  RoundIndex x;
+  x.r_ = vector<Round>(t.next_int());
+  for (Round& r : x.r_) {
+    r.commands = t.next_long_long();
+    r.state    = t.next_long_long();
+    r.end      = t.next_long_long();
+  }
+  return x;
+}
+
+
+void RoundIndex::write (ostream& os) const {
+  Writer w(os);
+  w << "states " << r_.size() << '\n';
+  for (const Round& r : r_)
+    w << r.commands << ' ' << r.state << ' ' << r.end << '\n';
+  w.flush();
+}
+
+
+void RoundIndex::add (long long commands, long long state) {
+  if (not r_.empty()) r_.back().end = commands >= 0 ? commands : state;
+  r_.push_back({commands, state, -1});
+}
+
+
+void RoundIndex::finish (long long end) {
+  if (not r_.empty()) r_.back().end = end;
+}
+
+
+// ***************************************************************************
+
+
+IndexedReplay::IndexedReplay (const string& replay) :
+  file_(replay), index_(RoundIndex::scan(file_.data(), file_.size())) {
+  read_header();
+}
+
+
+IndexedReplay::IndexedReplay (const string& replay, const string& index) :
+  file_(replay) {
+  Tokenizer t(index);
+  index_ = RoundIndex::read(t);
+  read_header();
+}
+
+
+void IndexedReplay::read_header () {
+  _my_assert(index_.size() > 0, "No states found in the game.");
+  Tokenizer t(file_.data(), index_[0].state);
+
+  Token g = t.next();
+  _my_assert(g == "Game" or g == "SecGame", "Expected 'Game' while parsing.");
+  _my_assert(t.next() == "Seed", "Expected 'Seed' while parsing.");
+  seed_ = t.next_int();
+
+  *static_cast<Settings*>(&info_) = Settings::read_settings(t);
+
+  _my_assert(t.next() == "names", "Expected 'names' while parsing.");
+  names_ = vector<string>(info_.nb_players());
+  for (string& name : names_) name = t.next().str();
+
+  format_ = 1;
+  if (not t.eof()) {
+    _my_assert(t.next() == "format", "Expected 'format' while parsing.");
+    format_ = t.next_int();
+    _my_assert(format_ >= 2 and format_ <= Board::FORMAT, "Wrong format.");
+    info_.read_cities_and_paths(t);
+  }
+}
+
+
+const Info& IndexedReplay::state (int r) {
+  const RoundIndex::Round& x = index_[r];
+  _my_assert(x.end <= (long long)file_.size(), "Index does not match the game.");
+  Tokenizer t(file_.data() + x.state, x.end - x.state);
+  info_.read_state(t);
+  _my_assert(info_.round() == r, "Index does not match the game.");
+  return info_;
+}
+
+
+vector<Command> IndexedReplay::commands (int r) const {
+  _my_assert(r >= 1, "Round 0 has no commands.");
+  const RoundIndex::Round& x = index_[r];
+  _my_assert(x.commands >= 0 and x.state <= (long long)file_.size(),
+             "Index does not match the game.");
+  Tokenizer t(file_.data() + x.commands, x.state - x.commands);
+  _my_assert(t.next() == "commands", "Expected 'commands' while parsing.");
+  return Action(t).v_;
+}
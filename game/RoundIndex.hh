@@ -0,0 +1,175 @@
+#ifndef RoundIndex_hh
+#define RoundIndex_hh
+
+
+#include "Board.hh"
+
+
+/*! \file
+ * Contains an index of the rounds of a game in the text format,
+ * and a reader that uses it to parse only the requested rounds.
+ */
+
+
+/**
+ * Byte offsets of the blocks of every round of a game in the text format.
+ * Can be recorded while the game is written, or rebuilt from the text.
+ *
+ * As a sidecar file, it is written as a line "states n" followed by one
+ * line per state with its three offsets.
+ */
+class RoundIndex {
+
+public:
+
+  /**
+   * Offsets of the blocks of a round.
+   */
+  struct Round {
+    long long commands; // Line "commands" before the state, -1 for round 0.
+    long long    state; // First char printed by Board::print_state.
+    long long      end; // End of the state.
+  };
+
+  /**
+   * Builds the index of a game by scanning its text for the lines
+   * starting the blocks.
+   */
+  static RoundIndex scan (const char* data, size_t size);
+
+  /**
+   * Reads an index written with write().
+   */
+  static RoundIndex read (Tokenizer& t);
+
+  /**
+   * Writes the index to a stream.
+   */
+  void write (ostream& os) const;
+
+  /**
+   * Adds the next round, given the offsets of its commands
+   * (-1 for round 0) and of its state.
+   */
+  void add (long long commands, long long state);
+
+  /**
+   * Sets the end of the last state.
+   */
+  void finish (long long end);
+
+  /**
+   * Returns the number of states, i.e., the number of rounds plus one.
+   */
+  int size () const;
+
+  /**
+   * Returns the offsets of round r.
+   */
+  const Round& operator[] (int r) const;
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  vector<Round> r_;
+
+};
+
+
+/**
+ * Gives random access to the rounds of a game in the text format,
+ * mapped in memory. Only the block of the requested round is parsed.
+ */
+class IndexedReplay {
+
+public:
+
+  /**
+   * Opens a game, building its index by scanning it.
+   */
+  IndexedReplay (const string& replay);
+
+  /**
+   * Opens a game, reading its index from a sidecar file.
+   */
+  IndexedReplay (const string& replay, const string& index);
+
+  /**
+   * Returns the seed of the game.
+   */
+  int seed () const;
+
+  /**
+   * Returns the format of the text (see Board::FORMAT).
+   */
+  int format () const;
+
+  /**
+   * Returns the names of the players.
+   */
+  const vector<string>& names () const;
+
+  /**
+   * Returns the index of the game.
+   */
+  const RoundIndex& index () const;
+
+  /**
+   * Parses the state after round r (0 for the initial state).
+   * The returned reference is valid until the next call.
+   */
+  const Info& state (int r);
+
+  /**
+   * Parses the commands performed in round r, for r >= 1.
+   */
+  vector<Command> commands (int r) const;
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  MappedFile         file_;
+  RoundIndex        index_;
+  Info               info_;
+  int                seed_;
+  int              format_;
+  vector<string>    names_;
+
+  void read_header ();
+
+};
+
+
+inline int RoundIndex::size () const {
+  return r_.size();
+}
+
+inline const RoundIndex::Round& RoundIndex::operator[] (int r) const {
+  _my_assert(r >= 0 and r < size(), "Round is not ok.");
+  return r_[r];
+}
+
+inline int IndexedReplay::seed () const {
+  return seed_;
+}
+
+inline int IndexedReplay::format () const {
+  return format_;
+}
+
+inline const vector<string>& IndexedReplay::names () const {
+  return names_;
+}
+
+inline const RoundIndex& IndexedReplay::index () const {
+  return index_;
+}
+
+
+#endif
@@ -3,6 +3,7 @@
 
 
 #include "Structs.hh"
+#include "Tokenizer.hh"
 
 
 /** \file
@@ -92,6 +93,27 @@ public:
    */
   bool pos_ok (Pos p) const;
 
+  /**
+   * Returns the points of a connected component with the given number of
+   * cities: factor * 2^size, but growing only linearly beyond
+   * MAX_COMPONENT_EXPONENT cities, and at most INT_MAX.
+   */
+  static int connected_component_bonus (int factor, int size);
+
+  /**
+   * Adds points to a total score, which stays at INT_MAX rather than
+   * overflowing: totals are ints, and big components give INT_MAX
+   * points every round.
+   */
+  static void add_score (int& total, long long points);
+
+  /**
+   * Limits of the settings.
+   */
+  static const int MAX_PLAYERS = 100;
+  static const int MAX_SIDE    = 4096;
+  static const int MAX_COMPONENT_EXPONENT = 25;
+
 
   //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
 
@@ -103,6 +125,9 @@ private:
   friend class Game;
   friend class SecGame;
   friend class Player;
+  friend class ReplayReader;
+  friend class ReplayView;
+  friend class IndexedReplay;
 
   int nb_players_;
   int rows_;
@@ -125,7 +150,7 @@ private:
   /**
    * Reads the settings from a stream.
    */
-  static Settings read_settings (istream& is);
+  static Settings read_settings (Tokenizer& t);
 
 };
 
@@ -190,5 +215,16 @@ inline bool Settings::pos_ok (Pos p) const {
   return pos_ok(p.i, p.j);
 }
 
+inline int Settings::connected_component_bonus (int factor, int size) {
+  const int E = MAX_COMPONENT_EXPONENT;
+  long long b = (long long)factor << min(size, E);
+  if (size > E) b *= size - E + 1;
+  return int(min(b, (long long)INT_MAX));
+}
+
+inline void Settings::add_score (int& total, long long points) {
+  total = int(min(total + points, (long long)INT_MAX));
+}
+
 
 #endif
@@ -0,0 +1,487 @@
+#include "SimBoard.hh"
+
+
+SimMap::SimMap (const Info& info) {
+  nb_players     = info.nb_players();
+  rows           = info.rows();
+  cols           = info.cols();
+  nb_rounds      = info.nb_rounds();
+  nb_units       = info.nb_units();
+  total_units    = info.total_units();
+  initial_health = info.initial_health();
+  bonus_per_city_cell        = info.bonus_per_city_cell();
+  bonus_per_path_cell        = info.bonus_per_path_cell();
+  factor_connected_component = info.factor_connected_component();
+  infection_factor           = info.infection_factor();
+  mask_protection            = info.mask_protection();
+
+  _my_assert(nb_players <= INT8_MAX, "Too many players for a SimBoard.");
+  _my_assert(rows <= INT16_MAX and cols <= INT16_MAX, "Board too large for a SimBoard.");
+  _my_assert(total_units <= INT16_MAX, "Too many units for a SimBoard.");
+  _my_assert(initial_health <= INT16_MAX - 100, "Initial health too large for a SimBoard.");
+  _my_assert(nb_rounds <= INT16_MAX, "Too many rounds for a SimBoard.");
+
+  int n = rows*cols;
+  type    = vector<uint8_t>(n);
+  same    = vector<uint8_t>(n, 0);
+  city_id = vector<int32_t>(n);
+  path_id = vector<int32_t>(n);
+  int nb_masks = 0;
+  for (int i = 0; i < rows; ++i)
+    for (int j = 0; j < cols; ++j) {
+      Cell c = info.cell(i, j);
+      type   [i*cols + j] = c.type;
+      city_id[i*cols + j] = c.city_id;
+      path_id[i*cols + j] = c.path_id;
+      nb_masks += c.mask;
+    }
+
+  // Same rule as Board::same.
+  for (int i = 0; i < rows; ++i)
+    for (int j = 0; j < cols; ++j) {
+      CellType t = CellType(type[i*cols + j]);
+      if (t == WALL) continue;
+      for (int d = 0; d < NONE; ++d) {
+        Pos p = Pos(i, j) + Dir(d);
+        if (not info.pos_ok(p)) continue;
+        CellType t2 = CellType(type[p.i*cols + p.j]);
+        if (t2 != WALL and (t == GRASS) == (t2 == GRASS))
+          same[i*cols + j] |= 1 << d;
+      }
+    }
+
+  city = vector<vector<int>>(info.nb_cities());
+  for (int k = 0; k < info.nb_cities(); ++k)
+    for (Pos p : info.city(k))
+      city[k].push_back(p.i*cols + p.j);
+
+  path     = vector<vector<int>>(info.nb_paths());
+  path_end = vector<pair<int, int>>(info.nb_paths());
+  for (int k = 0; k < info.nb_paths(); ++k) {
+    State::Path p = info.path(k);
+    path_end[k] = p.first;
+    for (Pos x : p.second)
+      path[k].push_back(x.i*cols + x.j);
+  }
+
+  // Same candidates as Board::spawn, in the same order.
+  set<int> s;
+  for (int i = 1; i + 1 < rows; ++i) {
+    s.insert(i*cols + 1);
+    s.insert(i*cols + cols - 2);
+  }
+  for (int j = 1; j + 1 < cols; ++j) {
+    s.insert(cols + j);
+    s.insert((rows - 2)*cols + j);
+  }
+  cands = vector<int>(s.begin(), s.end());
+
+  // At most one new mask every 5 rounds.
+  max_masks = nb_masks + nb_rounds/5 + 1;
+
+  // Layout of the state, sorted by alignment. The header is round and
+  // number of masks. The scratch area is used for spawning and for the
+  // connected components of scores; the rows area for virus propagation.
+  int nc = city.size();
+  int np = path.size();
+  int off = 2*sizeof(int);
+  off_score      = off;  off += nb_players*sizeof(int);
+  off_scratch    = off;  off += max(int(cands.size()), 2*nc)*sizeof(int);
+  off_unit       = off;  off += total_units*4*sizeof(int16_t) + total_units*4;
+  off_mask       = off;  off += 2*max_masks*sizeof(int16_t);
+  off_unit_at    = off;  off += n*sizeof(int16_t);
+  off_city_owner = off;  off += nc;
+  off_path_owner = off;  off += np;
+  off_virus      = off;  off += n;
+  off_rows       = off;  off += 2*cols;
+  size = off;
+}
+
+
+SimBoard::SimBoard (const Info& info, const Random_generator& rng) :
+  SimBoard(info, 0) {
+  *static_cast<Random_generator*>(this) = rng;
+}
+
+
+SimBoard::SimBoard (const Info& info, int seed) {
+  static_assert(sizeof(SimUnit) == 4*sizeof(int16_t) + 4, "Unexpected padding of SimUnit.");
+
+  map_ = make_shared<SimMap>(info);
+  buf_ = vector<long long>((map_->size + 7)/8, 0);
+  set_random_seed(seed);
+
+  const SimMap& m = *map_;
+  round_() = info.round();
+  for (int pl = 0; pl < m.nb_players; ++pl)
+    score_()[pl] = info.total_score(pl);
+  for (int k = 0; k < int(m.city.size()); ++k)
+    city_owner_()[k] = info.city_owner(k);
+  for (int k = 0; k < int(m.path.size()); ++k)
+    path_owner_()[k] = info.path_owner(k);
+
+  for (int id = 0; id < m.total_units; ++id) {
+    Unit u = info.unit(id);
+    SimUnit& s = unit_()[id];
+    s.i      = u.pos.i;
+    s.j      = u.pos.j;
+    s.health = u.health;
+    s.turns  = u.turns;
+    s.player = u.player;
+    s.damage = u.damage;
+    s.immune = u.immune;
+    s.mask   = u.mask;
+  }
+
+  for (int i = 0; i < m.rows; ++i)
+    for (int j = 0; j < m.cols; ++j) {
+      Cell c = info.cell(i, j);
+      unit_at_()[i*m.cols + j] = c.unit_id;
+      virus_  ()[i*m.cols + j] = c.virus | (c.mask ? MASK_BIT : 0);
+    }
+
+  // The order of the masks matters for printing and picking them up.
+  nb_masks_() = info.masks_.size();
+  for (int k = 0; k < nb_masks(); ++k) {
+    mask_()[2*k    ] = info.masks_[k].i;
+    mask_()[2*k + 1] = info.masks_[k].j;
+  }
+}
+
+
+Cell SimBoard::cell (int i, int j) const {
+  const SimMap& m = *map_;
+  if (i < 0 or i >= m.rows or j < 0 or j >= m.cols) {
+    _log(LOG_WARNING, LOG_QUERY, "cell requested for position " << Pos(i, j));
+    return Cell();
+  }
+  int c = i*m.cols + j;
+  uint8_t v = at<uint8_t>(m.off_virus)[c];
+  return Cell(CellType(m.type[c]), at<int16_t>(m.off_unit_at)[c],
+              m.city_id[c], m.path_id[c], v & ~MASK_BIT, v & MASK_BIT);
+}
+
+
+Unit SimBoard::unit (int id) const {
+  _my_assert(id >= 0 and id < map_->total_units, "Invalid identifier.");
+  const SimUnit& u = at<SimUnit>(map_->off_unit)[id];
+  return Unit(id, u.player, Pos(u.i, u.j), u.health, u.damage, u.turns, u.immune, u.mask);
+}
+
+
+// Same as Board::apply, step by step.
+void SimBoard::next (const vector<Action>& act, vector<Command>* done) {
+  const SimMap& m = *map_;
+  ++round_();
+
+  int np = m.nb_players;
+  int nu = m.total_units;
+
+  // Chooses (at most) one command per unit.
+  vector<bool> seen(nu, false);
+  vector<Command> v;
+  for (int pl = 0; pl < np; ++pl)
+    for (const Command& c : act[pl].v_) {
+      int id = c.id;
+      Dir dir = c.dir;
+      if (id < 0 or id >= nu)
+        _log(LOG_WARNING, LOG_COMMAND, "id out of range : " << id)
+      else if (unit_()[id].player != pl)
+        _log(LOG_WARNING, LOG_COMMAND, "unit " << id << " of player " << int(unit_()[id].player)
+             << " not owned by " << pl)
+      else {
+        _my_assert(not seen[id], "More than one command for the same unit.");
+        seen[id] = true;
+        if (not dir_ok(dir))
+          _log(LOG_WARNING, LOG_COMMAND, "direction not valid: " << dir)
+        else if (dir != NONE)
+          v.push_back(Command(id, dir));
+      }
+    }
+
+  // Executes commands using a random order.
+  int num = v.size();
+  vector<int> perm = random_permutation(num);
+  vector<bool> killed(nu, false);
+  if (done) done->clear();
+  for (int i = 0; i < num; ++i) {
+    Command c = v[perm[i]];
+    if (not killed[c.id] and move(c.id, c.dir, killed) and done)
+      done->push_back(c);
+  }
+
+  propagate(killed);
+
+  vector<int> dead;
+  for (int id = 0; id < nu; ++id)
+    if (killed[id]) dead.push_back(id);
+
+  spawn(dead);
+
+  if (round() % 5 == 0 and round() < m.nb_rounds) spawn_mask();
+
+  compute_total_scores();
+}
+
+
+bool SimBoard::move (int id, Dir dir, vector<bool>& killed) {
+  const SimMap& m = *map_;
+  SimUnit& u = unit_()[id];
+  _my_assert(u.health >= 0, "Health cannot be negative.");
+
+  Pos p2 = Pos(u.i, u.j) + dir;
+  if (p2.i < 0 or p2.i >= m.rows or p2.j < 0 or p2.j >= m.cols) return false;
+
+  int c1 = u.i*m.cols + u.j;
+  int c2 = p2.i*m.cols + p2.j;
+  if (m.type[c2] == WALL) return false;
+
+  int16_t* unit_at = unit_at_();
+  int id2 = unit_at[c2];
+  if (id2 != -1) {
+    SimUnit& u2 = unit_()[id2];
+    _my_assert(u2.health >= 0, "Health cannot be negative.");
+    if (u2.player == u.player) return false;
+    int damage = random(25, 40);
+    u2.health -= damage;
+    if (u2.health < 0) kill(id2, u.player, killed);
+    else return false;
+  }
+
+  unit_at[c1] = -1;
+  unit_at[c2] = id;
+  u.i = p2.i;
+  u.j = p2.j;
+  uint8_t& v = virus_()[c2];
+  if ((v & MASK_BIT) and not u.mask) {
+    u.mask = true;
+    v &= ~MASK_BIT;
+    int16_t* mk = mask_();
+    int n = nb_masks();
+    int k = 0;
+    while (mk[2*k] != p2.i or mk[2*k + 1] != p2.j) ++k;
+    _my_assert(k < n, "Cannot find mask.");
+    swap(mk[2*k    ], mk[2*(n-1)    ]);
+    swap(mk[2*k + 1], mk[2*(n-1) + 1]);
+    --nb_masks_();
+  }
+  return true;
+}
+
+
+void SimBoard::kill (int id, int pl, vector<bool>& killed) {
+  _my_assert(not killed[id], "Cannot already be dead.");
+  killed[id] = true;
+
+  SimUnit& u = unit_()[id];
+  unit_at_()[u.i*map_->cols + u.j] = -1;
+  u.player = pl;
+  u.i      = -1;
+  u.j      = -1;
+  u.health = map_->initial_health;
+  u.immune = false;
+  u.mask   = false;
+  if (random(0, 4)) {
+    u.damage = 0;
+    u.turns  = 0;
+  }
+  else {
+    u.damage = random(2, 4);
+    u.turns  = 1;
+  }
+}
+
+
+void SimBoard::propagate (vector<bool>& killed) {
+  const SimMap& m = *map_;
+  const uint8_t VIRUS = MASK_BIT - 1;
+  SimUnit* unit = unit_();
+  uint8_t* virus = virus_();
+  int nu = m.total_units;
+
+  // Every non-masked infected propagates the virus.
+  for (int id = 0; id < nu; ++id) {
+    const SimUnit& u = unit[id];
+    if (not killed[id] and u.damage > 0 and not u.mask)
+      virus[u.i*m.cols + u.j] += 3;
+  }
+
+  // Virus travels to adjacent cells. Rows are updated in place, keeping
+  // a copy of the old values of the previous and the current row.
+  uint8_t* prev = rows_();
+  uint8_t* cur  = prev + m.cols;
+  for (int i = 0; i < m.rows; ++i) {
+    uint8_t* row = virus + i*m.cols;
+    for (int j = 0; j < m.cols; ++j) cur[j] = row[j] & VIRUS;
+    for (int j = 0; j < m.cols; ++j) {
+      int c = i*m.cols + j;
+      if (m.type[c] == WALL) continue;
+      int s = m.same[c];
+      int vir = max(0, cur[j] - 1);
+      if (s & (1 << BOTTOM)) vir = max(vir, (row[j + m.cols] & VIRUS) - 1);
+      if (s & (1 << TOP))    vir = max(vir, prev[j] - 1);
+      if (s & (1 << RIGHT))  vir = max(vir, cur[j+1] - 1);
+      if (s & (1 << LEFT))   vir = max(vir, cur[j-1] - 1);
+      vir = min(vir, m.type[c] == GRASS ? 4 : 10);
+      row[j] = (row[j] & MASK_BIT) | vir;
+    }
+    swap(prev, cur);
+  }
+
+  for (int id = 0; id < nu; ++id) {
+    SimUnit& u = unit[id];
+    if (not killed[id]) {
+      // Infect susceptible units.
+      if (u.damage == 0 and not u.immune) {
+        double p = (virus[u.i*m.cols + u.j] & VIRUS)/m.infection_factor;
+        if (u.mask) p /= m.mask_protection;
+        if (bernoulli(p)) {
+          u.damage = random(2, 5);
+          u.turns = 1;
+        }
+      }
+      // Decide if units are no longer infected.
+      else if (not u.immune) {
+        ++u.turns;
+        double p = 0.001*(u.turns*u.turns/16. + 1);
+        if (bernoulli(p)) {
+          u.damage = 0;
+          u.immune = true;
+        }
+      }
+    }
+  }
+
+  // Deal damage to infected units.
+  for (int id = 0; id < nu; ++id) {
+    unit[id].health -= unit[id].damage;
+    if (unit[id].health < 0)
+      kill(id, random(0, m.nb_players - 1), killed);
+  }
+}
+
+
+bool SimBoard::valid_to_spawn (int c) {
+  const SimMap& m = *map_;
+  CellType t = CellType(m.type[c]);
+  if (t == WALL or t == CITY or t == PATH) return false;
+  const int16_t* unit_at = unit_at_();
+  int i = c / m.cols;
+  int j = c % m.cols;
+  if (unit_at[c] != -1) return false;
+  if (i + 1 < m.rows and unit_at[c + m.cols] != -1) return false;
+  if (i > 0          and unit_at[c - m.cols] != -1) return false;
+  if (j + 1 < m.cols and unit_at[c + 1]      != -1) return false;
+  if (j > 0          and unit_at[c - 1]      != -1) return false;
+  return true;
+}
+
+
+void SimBoard::spawn (const vector<int>& gen) {
+  if (gen.empty()) return;
+
+  const SimMap& m = *map_;
+  int* cands = scratch_();
+  int n = m.cands.size();
+  copy(m.cands.begin(), m.cands.end(), cands);
+
+  for (int id : gen) {
+    int c = -1;
+    while (c == -1 and n > 0) {
+      int k = random(0, n-1);
+      if (valid_to_spawn(cands[k])) c = cands[k];
+      copy(cands + k + 1, cands + n, cands + k);
+      --n;
+    }
+    if (c == -1) // This should very very rarely happen.
+      for (int k = 0; k < m.rows*m.cols and c == -1; ++k)
+        if (valid_to_spawn(k)) c = k;
+    _my_assert(c != -1, "Cannot find a cell to regenerate units");
+    SimUnit& u = unit_()[id];
+    u.i = c / m.cols;
+    u.j = c % m.cols;
+    unit_at_()[c] = id;
+  }
+}
+
+
+void SimBoard::spawn_mask () {
+  const SimMap& m = *map_;
+  // Board::spawn_mask keeps trying until it finds a cell.
+  int i, j, c;
+  do {
+    i = random(2, m.rows - 3);
+    j = random(2, m.cols - 3);
+    c = i*m.cols + j;
+  } while (m.type[c] != GRASS or unit_at_()[c] != -1 or (virus_()[c] & MASK_BIT));
+
+  virus_()[c] |= MASK_BIT;
+  _my_assert(nb_masks() < m.max_masks, "Too many masks.");
+  mask_()[2*nb_masks()    ] = i;
+  mask_()[2*nb_masks() + 1] = j;
+  ++nb_masks_();
+}
+
+
+void SimBoard::score_city_or_path (int bonus, const vector<int>& v, int8_t& owner) {
+  const SimMap& m = *map_;
+  const int16_t* unit_at = unit_at_();
+  const SimUnit* unit = unit_();
+
+  int sc[INT8_MAX];
+  fill(sc, sc + m.nb_players, 0);
+  for (int c : v)
+    if (unit_at[c] != -1) ++sc[unit[unit_at[c]].player];
+
+  int max_sc = 0;
+  int max_pl = -1; // *Only* player with maximum score (-1 if more than one).
+  for (int pl = 0; pl < m.nb_players; ++pl) {
+    if (sc[pl] > max_sc) {
+      max_sc = sc[pl];
+      max_pl = pl;
+    }
+    else if (sc[pl] == max_sc) max_pl = -1;
+  }
+  if (max_pl != -1) owner = max_pl; // Change of owner.
+  if (owner != -1) Settings::add_score(score_()[owner], (long long)bonus * v.size());
+}
+
+
+void SimBoard::compute_total_scores () {
+  const SimMap& m = *map_;
+  int* score = score_();
+  int8_t* city_owner = city_owner_();
+  int8_t* path_owner = path_owner_();
+  int nc = m.city.size();
+  int np = m.path.size();
+
+  for (int k = 0; k < nc; ++k)
+    score_city_or_path(m.bonus_per_city_cell, m.city[k], city_owner[k]);
+  for (int k = 0; k < np; ++k)
+    score_city_or_path(m.bonus_per_path_cell, m.path[k], path_owner[k]);
+
+  // Connected components of the graph of each player, with union-find.
+  int* parent = scratch_();
+  int* size   = parent + nc;
+  auto find = [&] (int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+  };
+  for (int pl = 0; pl < m.nb_players; ++pl) {
+    for (int k = 0; k < nc; ++k) {
+      parent[k] = k;
+      size[k] = 0;
+    }
+    for (int k = 0; k < np; ++k) {
+      int a = m.path_end[k].first;
+      int b = m.path_end[k].second;
+      if (path_owner[k] == pl and city_owner[a] == pl and city_owner[b] == pl)
+        parent[find(a)] = find(b);
+    }
+    for (int k = 0; k < nc; ++k)
+      if (city_owner[k] == pl) ++size[find(k)];
+    for (int k = 0; k < nc; ++k)
+      if (size[k] > 0)
+        Settings::add_score(score[pl], Settings::connected_component_bonus(m.factor_connected_component, size[k]));
+  }
+}
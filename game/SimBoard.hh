@@ -0,0 +1,240 @@
+#ifndef SimBoard_hh
+#define SimBoard_hh
+
+
+#include <cstdint>
+#include <memory>
+
+#include "Info.hh"
+#include "Action.hh"
+#include "Random.hh"
+
+
+/*! \file
+ * Contains the SimBoard class, a compact engine applying the same rules
+ * as Board, meant for simulating a large number of rounds.
+ */
+
+
+/**
+ * Data of a game that never changes once the board has been generated:
+ * settings, cell types, cities and paths, and the layout of the state
+ * of the SimBoards. It is shared by all the SimBoards of a game.
+ */
+struct SimMap {
+
+  int nb_players, rows, cols, nb_rounds, nb_units, total_units;
+  int initial_health;
+  int bonus_per_city_cell, bonus_per_path_cell, factor_connected_component;
+  double infection_factor, mask_protection;
+
+  vector<uint8_t>           type; // CellType of every cell.
+  vector<uint8_t>           same; // Bit d set iff the neighbour in Dir d
+                                  // exchanges virus with the cell.
+  vector<int32_t>        city_id; // City of every cell, -1 if none.
+  vector<int32_t>        path_id; // Path of every cell, -1 if none.
+  vector<vector<int>>       city; // Cells of every city.
+  vector<vector<int>>       path; // Cells of every path.
+  vector<pair<int, int>> path_end; // Cities joined by every path.
+  vector<int>              cands; // Candidate cells for spawning, sorted.
+
+  // Offsets (in bytes) of the arrays in the state of a SimBoard.
+  int off_score, off_unit, off_mask, off_unit_at, off_scratch;
+  int off_city_owner, off_path_owner, off_virus, off_rows;
+  int max_masks, size;
+
+  SimMap (const Info& info);
+
+};
+
+
+/**
+ * Stores the state of a game in a single contiguous block of a few
+ * kilobytes (plus the random seed), with byte-sized cell fields and
+ * 16-bit unit fields. The static data is shared through a SimMap.
+ * Copying a SimBoard amounts to one memcpy.
+ *
+ * Rounds are computed with exactly the same rules, and the same sequence
+ * of random numbers, as Board::next.
+ */
+class SimBoard : public Random_generator {
+
+public:
+
+  /**
+   * Construct a simulation board from the information of a game,
+   * with the given random seed.
+   */
+  SimBoard (const Info& info, int seed);
+
+  /**
+   * Construct a simulation board from the information of a game,
+   * continuing the sequence of random numbers of rng (e.g., a Board).
+   */
+  SimBoard (const Info& info, const Random_generator& rng);
+
+  /**
+   * Sets the random seed.
+   */
+  void set_seed (int seed);
+
+  /**
+   * Computes the next round applying the given actions, one per player.
+   * If done is not null, stores there the commands actually performed.
+   */
+  void next (const vector<Action>& act, vector<Command>* done = 0);
+
+  /**
+   * Returns the static data of the game.
+   */
+  const SimMap& map () const;
+
+  /**
+   * Returns the current round.
+   */
+  int round () const;
+
+  /**
+   * Returns the total score of a player.
+   */
+  int total_score (int pl) const;
+
+  /**
+   * Returns the cell at (i, j), as State::cell does.
+   */
+  Cell cell (int i, int j) const;
+
+  /**
+   * Returns the information of the unit with identifier id.
+   */
+  Unit unit (int id) const;
+
+  /**
+   * Returns the player who last conquered city id, -1 if none.
+   */
+  int city_owner (int id) const;
+
+  /**
+   * Returns the player who last conquered path id, -1 if none.
+   */
+  int path_owner (int id) const;
+
+  /**
+   * Returns the number of masks on the board.
+   */
+  int nb_masks () const;
+
+  /**
+   * Returns the position of the k-th mask on the board.
+   */
+  Pos mask (int k) const;
+
+  /**
+   * Returns the size in bytes of the state.
+   */
+  int state_size () const;
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  // Packed unit. Position is (-1, -1) while waiting to be spawned.
+  struct SimUnit {
+    int16_t i, j;
+    int16_t health;
+    int16_t turns;
+    int8_t  player;
+    int8_t  damage;
+    uint8_t immune;
+    uint8_t mask;
+  };
+
+  // Flag in the virus byte of a cell meaning that it has a mask.
+  static const uint8_t MASK_BIT = 0x80;
+
+  shared_ptr<const SimMap> map_;
+  vector<long long>        buf_; // The state, aligned to 8 bytes.
+
+  template <class T> inline T* at (int off) {
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(buf_.data()) + off);
+  }
+  template <class T> inline const T* at (int off) const {
+    return reinterpret_cast<const T*>(reinterpret_cast<const char*>(buf_.data()) + off);
+  }
+
+  // Header of the state.
+  inline int& round_    () { return at<int>(0)[0]; }
+  inline int& nb_masks_ () { return at<int>(0)[1]; }
+
+  inline int*      score_      () { return at<int>     (map_->off_score);      }
+  inline SimUnit*  unit_       () { return at<SimUnit> (map_->off_unit);       }
+  inline int16_t*  mask_       () { return at<int16_t> (map_->off_mask);       }
+  inline int16_t*  unit_at_    () { return at<int16_t> (map_->off_unit_at);    }
+  inline int*      scratch_    () { return at<int>     (map_->off_scratch);    }
+  inline int8_t*   city_owner_ () { return at<int8_t>  (map_->off_city_owner); }
+  inline int8_t*   path_owner_ () { return at<int8_t>  (map_->off_path_owner); }
+  inline uint8_t*  virus_      () { return at<uint8_t> (map_->off_virus);      }
+  inline uint8_t*  rows_       () { return at<uint8_t> (map_->off_rows);       }
+
+  // Returns true with probability p, as Board::bernoulli.
+  inline bool bernoulli (double p) {
+    const int N = 10000;
+    return random(1, N) <= int(N*p);
+  }
+
+  bool move (int id, Dir dir, vector<bool>& killed);
+  void kill (int id, int pl, vector<bool>& killed);
+  void propagate (vector<bool>& killed);
+  bool valid_to_spawn (int c);
+  void spawn (const vector<int>& gen);
+  void spawn_mask ();
+  void compute_total_scores ();
+  void score_city_or_path (int bonus, const vector<int>& v, int8_t& owner);
+
+};
+
+
+inline void SimBoard::set_seed (int seed) {
+  set_random_seed(seed);
+}
+
+inline const SimMap& SimBoard::map () const {
+  return *map_;
+}
+
+inline int SimBoard::round () const {
+  return at<int>(0)[0];
+}
+
+inline int SimBoard::total_score (int pl) const {
+  _my_assert(pl >= 0 and pl < map_->nb_players, "Player is not ok.");
+  return at<int>(map_->off_score)[pl];
+}
+
+inline int SimBoard::city_owner (int id) const {
+  _my_assert(id >= 0 and id < int(map_->city.size()), "City is not ok.");
+  return at<int8_t>(map_->off_city_owner)[id];
+}
+
+inline int SimBoard::path_owner (int id) const {
+  _my_assert(id >= 0 and id < int(map_->path.size()), "Path is not ok.");
+  return at<int8_t>(map_->off_path_owner)[id];
+}
+
+inline int SimBoard::nb_masks () const {
+  return at<int>(0)[1];
+}
+
+inline Pos SimBoard::mask (int k) const {
+  _my_assert(k >= 0 and k < nb_masks(), "Mask is not ok.");
+  const int16_t* m = at<int16_t>(map_->off_mask);
+  return Pos(m[2*k], m[2*k + 1]);
+}
+
+inline int SimBoard::state_size () const {
+  return map_->size;
+}
+
+#endif
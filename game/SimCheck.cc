@@ -0,0 +1,105 @@
+#include "Board.hh"
+#include "SimBoard.hh"
+
+
+/*! \file
+ * Differential test of SimBoard against Board: plays games with random
+ * commands on both and checks that they match after every round.
+ */
+
+
+/**
+ * Returns an empty string if b and s match, otherwise what differs.
+ */
+string differences (const Board& b, const SimBoard& s) {
+  ostringstream oss;
+  if (b.round() != s.round()) oss << "round ";
+  for (int pl = 0; pl < b.nb_players(); ++pl)
+    if (b.total_score(pl) != s.total_score(pl)) oss << "score of " << pl << ' ';
+  for (int k = 0; k < b.nb_cities(); ++k)
+    if (b.city_owner(k) != s.city_owner(k)) oss << "owner of city " << k << ' ';
+  for (int k = 0; k < b.nb_paths(); ++k)
+    if (b.path_owner(k) != s.path_owner(k)) oss << "owner of path " << k << ' ';
+  for (int id = 0; id < b.total_units(); ++id) {
+    Unit u = b.unit(id), v = s.unit(id);
+    if (u.player != v.player or u.pos != v.pos or u.health != v.health or
+        u.damage != v.damage or u.turns != v.turns or
+        u.immune != v.immune or u.mask != v.mask)
+      oss << "unit " << id << ' ';
+  }
+  for (int i = 0; i < b.rows(); ++i)
+    for (int j = 0; j < b.cols(); ++j) {
+      Cell c = b.cell(i, j), d = s.cell(i, j);
+      if (c.type != d.type or c.unit_id != d.unit_id or c.virus != d.virus or
+          c.mask != d.mask or c.city_id != d.city_id or c.path_id != d.path_id)
+        oss << "cell " << Pos(i, j) << ' ';
+    }
+  // Masks are listed in the same order as in print_state.
+  ostringstream bs, ss;
+  b.print_state(bs);
+  istringstream is(bs.str());
+  string l;
+  while (is >> l and l != "masks") ;
+  int n;
+  is >> n;
+  if (n != s.nb_masks()) oss << "number of masks ";
+  else
+    for (int k = 0; k < n; ++k) {
+      Pos p;
+      is >> p.i >> p.j;
+      if (p != s.mask(k)) oss << "mask " << k << ' ';
+    }
+  return oss.str();
+}
+
+
+int main (int argc, char** argv) {
+  if (argc < 3) {
+    cout << "Usage: " << argv[0] << " first_seed nb_seeds [< default.cnf]" << endl;
+    return EXIT_SUCCESS;
+  }
+  int first = string_to_int(argv[1]);
+  int n     = string_to_int(argv[2]);
+
+  ostringstream cnf;
+  cnf << cin.rdbuf();
+
+  int failed = 0;
+  for (int seed = first; seed < first + n; ++seed) {
+    istringstream is(cnf.str());
+    Board b(is, seed);
+    SimBoard s(b, b);
+    srand(seed);
+
+    int np = b.nb_players();
+    int nu = b.total_units();
+    string diff;
+    for (int round = 0; round < b.nb_rounds() and diff.empty(); ++round) {
+      // Mostly valid commands, plus a few wrong ones.
+      vector<Action> act(np);
+      for (int id = 0; id < nu; ++id)
+        if (rand() % 8) {
+          int pl = rand() % 20 ? b.unit(id).player : rand() % np;
+          act[pl].move(rand() % 50 ? id : nu + rand() % 3, Dir(rand() % DIR_SIZE));
+        }
+
+      ostringstream bc, sc;
+      b.next(act, bc);
+      vector<Command> done;
+      s.next(act, &done);
+      sc << "commands" << endl;
+      for (Command c : done)
+        sc << c.id << ' ' << "brtln"[c.dir] << endl;
+      sc << -1 << endl;
+
+      if (bc.str() != sc.str()) diff = "commands ";
+      diff += differences(b, s);
+      if (not diff.empty())
+        cout << "seed " << seed << ": mismatch at round " << b.round() << ": " << diff << endl;
+    }
+    if (diff.empty())
+      cout << "seed " << seed << ": ok (state of " << s.state_size() << " bytes)" << endl;
+    else ++failed;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,16 @@
+#include "Simulation.hh"
+
+
+Simulation::Simulation (const Info& info, int seed) :
+  board_(info, seed),
+  act_(info.nb_players()) { }
+
+
+void Simulation::next (int seed, int rounds) {
+  board_.set_random_seed(seed);
+  for (int r = 0; r < rounds; ++r) {
+    board_.apply(act_, done_);
+    if (r == 0)
+      for (Action& a : act_) a = Action();
+  }
+}
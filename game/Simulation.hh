@@ -0,0 +1,120 @@
+#ifndef Simulation_hh
+#define Simulation_hh
+
+
+#include "Board.hh"
+
+
+/*! \file
+ * Contains the Simulation class, a private copy of the game
+ * that players can advance on their own.
+ */
+
+
+/**
+ * Stores a copy of the game that can be advanced round by round with
+ * exactly the same rules as the real game. Useful for lookahead.
+ *
+ * A simulation is built from the information a player sees, and can be
+ * copied cheaply, so many of them can be tried during a single round.
+ */
+class Simulation {
+
+public:
+
+  /**
+   * Constructor, given the current information of the game
+   * (a player can simply pass *this) and a random seed.
+   */
+  Simulation (const Info& info, int seed = 0);
+
+  /**
+   * Returns the current (simulated) information of the game.
+   */
+  const Info& info () const;
+
+  /**
+   * Returns the action that player pl will perform in the next round.
+   * Players whose action is left empty do not move any unit.
+   */
+  Action& action (int pl);
+
+  /**
+   * Adds a command for unit id to the action of the player owning it.
+   */
+  void move (int id, Dir dir);
+
+  /**
+   * Advances the given number of rounds using the given random seed.
+   * The pending actions are performed in the first of these rounds,
+   * and are emptied afterwards.
+   */
+  void next (int seed, int rounds = 1);
+
+  /**
+   * Returns the commands actually performed in the last round.
+   */
+  const vector<Command>& commands_done () const;
+
+  /**
+   * Marks the current state, so that it can be restored later with
+   * rollback(). Checkpoints can be nested. This allows exploring a tree
+   * of moves with next() without copying the whole simulation.
+   */
+  void checkpoint ();
+
+  /**
+   * Restores the state of the last checkpoint, and removes it.
+   * Takes time proportional to the changes made since the checkpoint.
+   */
+  void rollback ();
+
+  /**
+   * Removes the last checkpoint, keeping the current state.
+   */
+  void commit ();
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  Board                 board_;
+  vector<Action>          act_;
+  vector<Command>        done_;
+
+};
+
+
+inline const Info& Simulation::info () const {
+  return board_;
+}
+
+inline Action& Simulation::action (int pl) {
+  _my_assert(board_.player_ok(pl), "Player is not ok.");
+  return act_[pl];
+}
+
+inline void Simulation::move (int id, Dir dir) {
+  _my_assert(id >= 0 and id < board_.total_units(), "Invalid identifier.");
+  act_[board_.unit(id).player].move(id, dir);
+}
+
+inline const vector<Command>& Simulation::commands_done () const {
+  return done_;
+}
+
+inline void Simulation::checkpoint () {
+  board_.checkpoint();
+}
+
+inline void Simulation::rollback () {
+  board_.rollback();
+}
+
+inline void Simulation::commit () {
+  board_.commit();
+}
+
+#endif
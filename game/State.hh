@@ -3,6 +3,7 @@
 
 
 #include "Structs.hh"
+#include "Log.hh"
 
 /*! \file
  * Contains a class to store the current state of a game.
@@ -113,6 +114,12 @@ private:
   friend class Game;
   friend class SecGame;
   friend class Player;
+  friend class JournalCheck;
+  friend class SimBoard;
+  friend class ReplayWriter;
+  friend class ReplayReader;
+  friend class ReplayView;
+  friend class MapCache;
 
   vector<City>              city_;
   vector<Path>              path_;
@@ -152,7 +159,7 @@ inline Cell State::cell (int i, int j) const {
   if (i >= 0 and i < (int)grid_.size() and j >= 0 and j < (int)grid_[i].size())
     return grid_[i][j];
   else {
-    cerr << "warning: cell requested for position " << Pos(i, j) << endl;
+    _log(LOG_WARNING, LOG_QUERY, "cell requested for position " << Pos(i, j));
     return Cell();
   }
 }
@@ -178,7 +185,7 @@ inline int State::total_score (int pl) const {
   if (pl >= 0 and pl < (int)total_score_.size())
     return total_score_[pl];
   else {
-    cerr << "warning: total score requested for player " << pl << endl;
+    _log(LOG_WARNING, LOG_QUERY, "total score requested for player " << pl);
     return -1;
   }
 }
@@ -187,7 +194,7 @@ inline double State::status (int pl) const {
   if (pl >= 0 and pl < (int)cpu_status_.size())
     return cpu_status_[pl];
   else {
-    cerr << "warning: status requested for player " << pl << endl;
+    _log(LOG_WARNING, LOG_QUERY, "status requested for player " << pl);
     return -2;
   }
 }
@@ -196,7 +203,7 @@ inline Unit State::unit (int id) const {
   if (unit_ok(id))
     return unit_[id];
   else {
-    cerr << "warning: unit requested for identifier " << id << endl;
+    _log(LOG_WARNING, LOG_QUERY, "unit requested for identifier " << id);
     return Unit();
   }
 }
@@ -205,7 +212,7 @@ inline State::City State::city(int id) const {
   if (city_ok(id))
     return city_[id];
   else {
-    cerr << "warning: city requested for identifier " << id << endl;
+    _log(LOG_WARNING, LOG_QUERY, "city requested for identifier " << id);
     return City();
   }
 }
@@ -214,7 +221,7 @@ inline State::Path State::path(int id) const {
   if (path_ok(id))
     return path_[id];
   else {
-    cerr << "warning: path requested for identifier " << id << endl;
+    _log(LOG_WARNING, LOG_QUERY, "path requested for identifier " << id);
     return Path();
   }
 }
@@ -223,7 +230,7 @@ inline int State::city_owner(int id) const {
   if (city_ok(id))
     return city_owner_[id];
   else {
-    cerr << "warning: city owner requested for identifier " << id << endl;
+    _log(LOG_WARNING, LOG_QUERY, "city owner requested for identifier " << id);
     return -1;
   }
 }
@@ -232,7 +239,7 @@ inline int State::path_owner(int id) const {
   if (path_ok(id))
     return path_owner_[id];
   else {
-    cerr << "warning: path owner requested for identifier " << id << endl;
+    _log(LOG_WARNING, LOG_QUERY, "path owner requested for identifier " << id);
     return -1;
   }
 }
@@ -240,7 +247,7 @@ inline int State::path_owner(int id) const {
 inline vector<int> State::my_units (int pl) {
   if (pl >= 0 and pl < (int)pl_units_.size()) return pl_units_[pl];
   else {
-    cerr << "warning: units requested for player " << pl << endl;
+    _log(LOG_WARNING, LOG_QUERY, "units requested for player " << pl);
     return vector<int>();
   }
 }
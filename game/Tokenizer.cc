@@ -0,0 +1,72 @@
+#include "Tokenizer.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+MappedFile::MappedFile (const string& file) : map_(0), size_(0) {
+  int fd = open(file.c_str(), O_RDONLY);
+  _my_assert(fd >= 0, "Cannot open file " + file + ".");
+  struct stat st;
+  _my_assert(fstat(fd, &st) == 0, "Cannot read file " + file + ".");
+  size_ = st.st_size;
+  if (size_ > 0) {
+    map_ = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    _my_assert(map_ != MAP_FAILED, "Cannot map file " + file + ".");
+  }
+  close(fd);
+}
+
+
+MappedFile::~MappedFile () {
+  if (map_) munmap(map_, size_);
+}
+
+
+Tokenizer::Tokenizer (const char* data, size_t size) :
+  begin_(data), p_(data), end_(data + size), file_(0), is_(0), base_(0) { }
+
+
+Tokenizer::Tokenizer (const string& file) :
+  file_(new MappedFile(file)), is_(0), base_(0) {
+  if (file_->size() > 0)
+    madvise((void*)file_->data(), file_->size(), MADV_SEQUENTIAL);
+  begin_ = p_ = file_->data();
+  end_ = begin_ + file_->size();
+}
+
+
+Tokenizer::Tokenizer (istream& is, int chunk) :
+  file_(0), is_(&is), buf_(chunk), base_(0) {
+  begin_ = p_ = end_ = buf_.data();
+}
+
+
+Tokenizer::~Tokenizer () {
+  delete file_;
+  if (is_ and p_ < end_) {
+    is_->clear();
+    is_->seekg(-(end_ - p_), ios::cur);
+  }
+}
+
+
+bool Tokenizer::fill (const char*& keep) {
+  if (not is_ or not *is_) return false;
+
+  // Moves the chars to keep to the start, and grows the buffer if full.
+  int k = end_ - keep;
+  int d = p_ - keep;
+  base_ += keep - begin_;
+  memmove(buf_.data(), keep, k);
+  if (k == int(buf_.size())) buf_.resize(2*k);
+
+  is_->read(buf_.data() + k, buf_.size() - k);
+  int n = is_->gcount();
+  begin_ = keep = buf_.data();
+  p_   = begin_ + d;
+  end_ = begin_ + k + n;
+  return n > 0;
+}
@@ -31,10 +31,17 @@ using namespace std;
  */
 
 
+/**
+ * Writes the message of a failed assertion as an error of the log, that
+ * is, after the messages still pending (see Log.hh).
+ */
+void assertion_failed (const string& msg);
+
+
 /**
  * Assert with message.
  */
-#define _my_assert(b, s) { if (not (b)) { cerr << "error: " << s << endl; assert(b); } }
+#define _my_assert(b, s) { if (not (b)) { ostringstream _oss; _oss << s; assertion_failed(_oss.str()); assert(b); } }
 
 
 /**
@@ -0,0 +1,267 @@
+
+// *********************************************************************
+// Reader of games in the binary replay format (see Replay.hh).
+//
+// Only the header and the footer are read when the game is loaded.
+// A round is rebuilt when it is requested, from the closest keyframe
+// before it (or from the current round, if it is closer) plus deltas,
+// so the rounds are never stored all at once.
+// *********************************************************************
+
+var BINARY_MAGIC  = "PNDB";
+var BINARY_FORMAT = 1;
+
+
+function BinaryReplay (buffer) {
+    this.bytes = new Uint8Array(buffer);
+    this.view  = new DataView(buffer);
+    this.p     = 0;
+
+    var h = new Object();
+    for (var k = 0; k < 4; ++k)
+        if (this.u8() != BINARY_MAGIC.charCodeAt(k)) throw new Error("Not a binary replay.");
+    if (this.varint() != BINARY_FORMAT) throw new Error("Unsupported format of binary replay.");
+
+    h.secgame = false;
+    h.version = "1.0";
+    h.format  = "binary";
+    h.seed    = this.svarint();
+
+    h.nb_players                 = this.varint();
+    h.rows                       = this.varint();
+    h.cols                       = this.varint();
+    h.nb_rounds                  = this.varint();
+    h.initial_health             = this.varint();
+    h.nb_units                   = this.varint();
+    h.bonus_per_city_cell        = this.varint();
+    h.bonus_per_path_cell        = this.varint();
+    h.factor_connected_component = this.varint();
+    h.infection_factor           = this.f64();
+    h.mask_protection            = this.f64();
+    h.total_units = h.nb_players * h.nb_units;
+
+    // Chars of the cell types, as cells without virus in the text format.
+    h.terrain = this.bytes.slice(this.p, this.p + h.rows*h.cols);
+    this.p += h.rows*h.cols;
+
+    h.nb_cities = this.varint();
+    h.cities = new Array();
+    for (var i = 0; i < h.nb_cities; ++i) {
+        h.cities[i] = new Object();
+        h.cities[i].size = this.varint();
+        h.cities[i].cell = new Array();
+        for (var j = 0; j < h.cities[i].size; ++j) h.cities[i].cell[j] = this.pos();
+    }
+    h.nb_paths = this.varint();
+    h.paths = new Array();
+    for (var i = 0; i < h.nb_paths; ++i) {
+        h.paths[i] = new Object();
+        h.paths[i].a    = this.varint();
+        h.paths[i].b    = this.varint();
+        h.paths[i].size = this.varint();
+        h.paths[i].cell = new Array();
+        for (var j = 0; j < h.paths[i].size; ++j) h.paths[i].cell[j] = this.pos();
+    }
+
+    h.names = new Array();
+    for (var i = 0; i < h.nb_players; ++i) {
+        var n = this.varint();
+        h.names[i] = String.fromCharCode.apply(null, this.bytes.subarray(this.p, this.p + n));
+        this.p += n;
+    }
+    this.interval = this.varint();
+    this.header = h;
+
+    // Footer: offsets of the keyframes, one every interval rounds.
+    this.end = this.view.getUint32(buffer.byteLength - 4, true);
+    this.p = this.end;
+    if (this.u8() != 'E'.charCodeAt(0)) throw new Error("Missing footer of binary replay.");
+    this.keyframes = new Array(this.varint());
+    for (var k = 0; k < this.keyframes.length; ++k) this.keyframes[k] = this.varint();
+    if (this.keyframes.length == 0) throw new Error("Missing initial keyframe.");
+
+    // State of the current round, in the layout of the text parser.
+    var rc = h.rows*h.cols;
+    this.virus = new Uint8Array(rc);
+    this.state = {
+        cells:       h.terrain.slice(),
+        units:       new Int32Array(h.total_units*UNIT_FIELDS),
+        moves:       new Uint8Array(h.total_units), // Commands of the next round.
+        score:       new Int32Array(h.nb_players),
+        cpu:         new Int16Array(h.nb_players),
+        city_owners: new Int8Array(h.nb_cities),
+        path_owners: new Int8Array(h.nb_paths),
+        masks:       new Int16Array(0)
+    };
+    this.maskBuffer = new Int16Array(2*rc);
+    this.round = -1;
+    this.next  = this.keyframes[0]; // Offset of the frame after the current round.
+}
+
+
+BinaryReplay.prototype.u8 = function () {
+    if (this.p >= this.bytes.length) throw new Error("Unexpected end of binary replay.");
+    return this.bytes[this.p++];
+}
+
+
+BinaryReplay.prototype.varint = function () {
+    var x = 0;
+    for (var s = 1; ; s *= 128) {
+        var c = this.u8();
+        x += (c & 0x7F)*s;
+        if (!(c & 0x80)) return x;
+    }
+}
+
+
+BinaryReplay.prototype.svarint = function () {
+    var x = this.varint();
+    return (x % 2) ? -(x + 1)/2 : x/2;
+}
+
+
+BinaryReplay.prototype.f64 = function () {
+    var x = this.view.getFloat64(this.p, true);
+    this.p += 8;
+    return x;
+}
+
+
+BinaryReplay.prototype.pos = function () {
+    var i = this.svarint();
+    var j = this.svarint();
+    return { i: i, j: j };
+}
+
+
+// Char code of a cell in the text format, given its type and virus.
+BinaryReplay.prototype.cellChar = function (k) {
+    var t = this.header.terrain[k];
+    var v = this.virus[k];
+    if (v == 0) return t;
+    if (t == 46) return 96 + v; // '.': 'a'..'d'
+    if (t == 44) return 47 + v; // ',': '0'..'9'
+    if (t == 59) return 64 + v; // ';': 'A'..'J'
+    return t;
+}
+
+
+// Returns the state after round r, valid until the next call.
+BinaryReplay.prototype.frame = function (r) {
+    if (r != this.round) {
+        var k = Math.floor(r/this.interval);
+        if (r < this.round || k*this.interval > this.round) {
+            this.next  = this.keyframes[k];
+            this.round = -1;
+        }
+        while (this.round < r) this.decode();
+        this.decodeMoves();
+    }
+    return this.state;
+}
+
+
+// Applies the frame at this.next.
+BinaryReplay.prototype.decode = function () {
+    var h = this.header;
+    var s = this.state;
+    this.p = this.next;
+
+    var tag = String.fromCharCode(this.u8());
+    if (tag != 'K' && tag != 'D') throw new Error("Wrong frame of binary replay.");
+    var key = (tag == 'K');
+    this.round = this.varint();
+
+    if (this.round > 0) {
+        for (var cnt = this.varint(); cnt > 0; --cnt) {
+            this.varint();
+            this.u8();
+        }
+    }
+
+    // Virus.
+    if (key) {
+        for (var k = 0; k < h.rows*h.cols; ++k) {
+            this.virus[k] = this.varint();
+            s.cells[k] = this.cellChar(k);
+        }
+    }
+    else {
+        var k = -1;
+        for (var cnt = this.varint(); cnt > 0; --cnt) {
+            k += this.varint() + 1;
+            this.virus[k] = this.varint();
+            s.cells[k] = this.cellChar(k);
+        }
+    }
+
+    // Masks.
+    var nb_masks = this.varint();
+    for (var m = 0; m < nb_masks; ++m) {
+        this.maskBuffer[2*m]     = this.svarint();
+        this.maskBuffer[2*m + 1] = this.svarint();
+    }
+    s.masks = this.maskBuffer.subarray(0, 2*nb_masks);
+
+    // Scores, as differences with the previous frame.
+    for (var pl = 0; pl < h.nb_players; ++pl) {
+        if (key) s.score[pl] = 0;
+        s.score[pl] += this.svarint();
+    }
+
+    // Status.
+    if (key || this.u8()) {
+        for (var pl = 0; pl < h.nb_players; ++pl) s.cpu[pl] = Math.trunc(this.f64()*100);
+    }
+
+    // Owners of cities and paths.
+    var owners = [s.city_owners, s.path_owners];
+    for (var t = 0; t < 2; ++t) {
+        if (key) {
+            for (var k = 0; k < owners[t].length; ++k) owners[t][k] = this.svarint();
+        }
+        else {
+            var k = -1;
+            for (var cnt = this.varint(); cnt > 0; --cnt) {
+                k += this.varint() + 1;
+                owners[t][k] = this.svarint();
+            }
+        }
+    }
+
+    // Units.
+    var cnt = key ? h.total_units : this.varint();
+    var id = -1;
+    for (; cnt > 0; --cnt) {
+        id += key ? 1 : this.varint() + 1;
+        var u = id*UNIT_FIELDS;
+        s.units[u + UNIT_PLAYER] = this.svarint();
+        s.units[u + UNIT_I]      = this.svarint();
+        s.units[u + UNIT_J]      = this.svarint();
+        s.units[u + UNIT_HEALTH] = this.svarint();
+        s.units[u + UNIT_DAMAGE] = this.svarint();
+        s.units[u + UNIT_TURNS]  = this.svarint();
+        s.units[u + UNIT_IMM]    = this.u8();
+        s.units[u + UNIT_MASK]   = this.u8();
+    }
+
+    this.next = this.p;
+}
+
+
+// Reads the commands at the start of the next frame, which are the moves
+// of the units from the current round, as in the text format.
+BinaryReplay.prototype.decodeMoves = function () {
+    var moves = this.state.moves;
+    for (var id = 0; id < moves.length; ++id) moves[id] = 0;
+    if (this.next >= this.end) return;
+
+    this.p = this.next;
+    this.u8();
+    this.varint();
+    for (var cnt = this.varint(); cnt > 0; --cnt) {
+        var id = this.varint();
+        moves[id] = this.u8();
+    }
+}
@@ -0,0 +1,381 @@
+
+// *********************************************************************
+// Parser of games in the text format (formats 1 and 2).
+//
+// The game is read chunk by chunk, and the rounds are given in batches
+// of typed arrays as soon as they are complete, so that the viewer can
+// start playing before the whole game is read. This file is run as a
+// Web Worker (see the end of the file), and is also included by the
+// viewer to parse in the page when workers are not available.
+// *********************************************************************
+
+var PARSE_CHUNK = 1 << 20; // Chars parsed at a time.
+var PARSE_BATCH = 16;      // Maximum number of rounds per message.
+
+// Fields of a unit, in the order of the file.
+var UNIT_PLAYER = 0;
+var UNIT_I      = 1;
+var UNIT_J      = 2;
+var UNIT_HEALTH = 3;
+var UNIT_DAMAGE = 4;
+var UNIT_TURNS  = 5;
+var UNIT_IMM    = 6;
+var UNIT_MASK   = 7;
+var UNIT_FIELDS = 8;
+
+var NEED_MORE = { }; // Thrown when the tokens run out in the middle of a block.
+
+
+function int (s) {
+    return parseInt(s);
+}
+
+
+function double (s) {
+    return parseFloat(s);
+}
+
+
+function parse_assert (read_value, expected_value) {
+    var correct = (read_value == expected_value);
+    if (!correct) throw new Error("Error parsing file, expected token: " + expected_value + ", read token: " + read_value + ".");
+    return correct;
+}
+
+
+// Messages are given to post, with the list of buffers they own:
+//   { type: "header", header: ... }  settings, names, cities and paths.
+//   { type: "rounds", first: r, count: n, ... }  rounds r to r + n - 1.
+//   { type: "done" }
+//   { type: "error", message: ..., binary: ... }  binary if the game is not text.
+function ReplayParser (post) {
+    this.post   = post;
+    this.tokens = [];   // Tokens not parsed yet.
+    this.p      = 0;    // Next token.
+    this.rest   = "";   // Text of the last chunk after its last whitespace.
+    this.header = null;
+    this.round  = 0;    // Next round to parse.
+    this.batch  = null; // Rounds parsed and not posted yet.
+}
+
+
+ReplayParser.prototype.next = function () {
+    if (this.p == this.tokens.length) throw NEED_MORE;
+    return this.tokens[this.p++];
+}
+
+
+ReplayParser.prototype.peek = function () {
+    if (this.p == this.tokens.length) throw NEED_MORE;
+    return this.tokens[this.p];
+}
+
+
+// Parses a chunk of text, last tells whether it is the end of the game.
+// Blocks are parsed when all their tokens have arrived.
+ReplayParser.prototype.push = function (chunk, last) {
+    var text = this.rest + chunk;
+    var cut = text.length;
+    if (!last) while (cut > 0 && !/\s/.test(text[cut - 1])) --cut;
+    this.rest = text.substring(cut);
+
+    var t = text.substring(0, cut).split(/\s+/);
+    var tokens = this.tokens.slice(this.p);
+    for (var k = 0; k < t.length; ++k) if (t[k] != "") tokens.push(t[k]);
+    this.tokens = tokens;
+    this.p = 0;
+
+    while (this.header == null || this.round <= this.header.nb_rounds) {
+        var start = this.p;
+        try {
+            if (this.header == null) this.parseHeader();
+            else this.parseRound();
+        }
+        catch (e) {
+            if (e !== NEED_MORE) throw e;
+            this.p = start;
+            break;
+        }
+    }
+    this.flush();
+
+    if (last) {
+        if (this.header == null) throw new Error("Could not load game file.");
+        if (this.round <= this.header.nb_rounds) throw new Error("The game file is truncated after round " + (this.round - 1) + ".");
+        this.post({ type: "done" }, []);
+    }
+}
+
+
+// Reads cities and paths into obj.
+ReplayParser.prototype.parseCitiesAndPaths = function (obj) {
+    // Cities.
+    parse_assert(this.next(), "cities");
+    obj.nb_cities = int(this.next());
+    obj.cities = new Array();
+    for (var i = 0; i < obj.nb_cities; ++i) {
+        obj.cities[i] = new Object();
+        obj.cities[i].size = int(this.next());
+        obj.cities[i].cell = new Array();
+        for (var j = 0; j < obj.cities[i].size; ++j) {
+            obj.cities[i].cell[j] = new Object();
+            obj.cities[i].cell[j].i = int(this.next());
+            obj.cities[i].cell[j].j = int(this.next());
+        }
+    }
+
+    // Paths.
+    parse_assert(this.next(), "paths");
+    obj.nb_paths = int(this.next());
+    obj.paths = new Array();
+    for (var i = 0; i < obj.nb_paths; ++i) {
+        obj.paths[i] = new Object();
+        obj.paths[i].a    = int(this.next());
+        obj.paths[i].b    = int(this.next());
+        obj.paths[i].size = int(this.next());
+        obj.paths[i].cell = new Array();
+        for (var j = 0; j < obj.paths[i].size; ++j) {
+            obj.paths[i].cell[j] = new Object();
+            obj.paths[i].cell[j].i = int(this.next());
+            obj.paths[i].cell[j].j = int(this.next());
+        }
+    }
+}
+
+
+ReplayParser.prototype.parseHeader = function () {
+    var h = new Object();
+
+    var first = this.next();
+    if (first.substring(0, 4) == "PNDB") {
+        var e = new Error("This is a binary replay.");
+        e.binary = true; // The viewer reads it with BinaryReplay.
+        throw e;
+    }
+    h.secgame = (first == "SecGame");
+
+    parse_assert(this.next(), "Seed");
+    h.seed = int(this.next());
+
+    // Game and version.
+    if (this.next() != "Pandemic") throw new Error("Are you sure this is a Pandemic game file?");
+    h.version = this.next();
+
+    parse_assert(this.next(), "nb_players");
+    h.nb_players = int(this.next());
+
+    parse_assert(this.next(), "rows");
+    h.rows = int(this.next());
+
+    parse_assert(this.next(), "cols");
+    h.cols = int(this.next());
+
+    parse_assert(this.next(), "nb_rounds");
+    h.nb_rounds = int(this.next());
+
+    parse_assert(this.next(), "initial_health");
+    h.initial_health = int(this.next());
+
+    parse_assert(this.next(), "nb_units");
+    h.nb_units = int(this.next());
+
+    parse_assert(this.next(), "bonus_per_city_cell");
+    h.bonus_per_city_cell = int(this.next());
+
+    parse_assert(this.next(), "bonus_per_path_cell");
+    h.bonus_per_path_cell = int(this.next());
+
+    parse_assert(this.next(), "factor_connected_component");
+    h.factor_connected_component = int(this.next());
+
+    parse_assert(this.next(), "infection_factor");
+    h.infection_factor = int(this.next());
+
+    parse_assert(this.next(), "mask_protection");
+    h.mask_protection = int(this.next());
+
+    h.total_units = h.nb_players * h.nb_units;
+
+    parse_assert(this.next(), "names");
+    h.names = new Array();
+    for (var i = 0; i < h.nb_players; ++i) h.names[i] = this.next();
+
+    // Format 2 prints cities and paths only once, after the names.
+    // Format 1 prints them in every round: the first ones are kept.
+    h.format = 1;
+    if (this.peek() == "format") {
+        this.next();
+        h.format = int(this.next());
+        this.parseCitiesAndPaths(h);
+    }
+    else {
+        var p = this.p;
+        for (var k = 0; k < 2 + 2*h.rows; ++k) this.next();
+        this.parseCitiesAndPaths(h);
+        this.p = p;
+    }
+
+    this.header = h;
+    this.post({ type: "header", header: h }, []);
+}
+
+
+ReplayParser.prototype.newBatch = function () {
+    var h = this.header;
+    var b = { type: "rounds", first: this.round, count: 0 };
+    b.cells       = new Uint8Array(PARSE_BATCH*h.rows*h.cols); // Chars of the cells.
+    b.units       = new Int32Array(PARSE_BATCH*h.total_units*UNIT_FIELDS);
+    b.moves       = new Uint8Array(PARSE_BATCH*h.total_units); // Chars of the commands, or 0.
+    b.score       = new Int32Array(PARSE_BATCH*h.nb_players);
+    b.cpu         = new Int16Array(PARSE_BATCH*h.nb_players);  // Percentage, -100 if out.
+    b.city_owners = new Int8Array(PARSE_BATCH*h.nb_cities);
+    b.path_owners = new Int8Array(PARSE_BATCH*h.nb_paths);
+    b.mask_start  = new Uint32Array(PARSE_BATCH + 1);          // Of every round in masks.
+    b.masks       = [];                                        // i and j of every mask.
+    return b;
+}
+
+
+ReplayParser.prototype.parseRound = function () {
+    var h = this.header;
+    if (this.batch == null) this.batch = this.newBatch();
+    var b = this.batch;
+    var k = b.count;
+    b.masks.length = b.mask_start[k];
+
+    // Maze.
+    this.next(); // 1st row of column labels.
+    this.next(); // 2nd row of column labels.
+    for (var i = 0; i < h.rows; ++i) {
+        parse_assert(this.next(), i);
+        var row = this.next();
+        if (row.length != h.cols) throw new Error("Wrong length of row " + i + " in round " + this.round + ".");
+        var c = (k*h.rows + i)*h.cols;
+        for (var j = 0; j < h.cols; ++j) b.cells[c + j] = row.charCodeAt(j);
+    }
+
+    // Cities and paths, in every round in format 1.
+    if (h.format == 1) this.parseCitiesAndPaths({ });
+
+    // Masks.
+    parse_assert(this.next(), "masks");
+    var nb_masks = int(this.next());
+    for (var i = 0; i < 2*nb_masks; ++i) b.masks.push(int(this.next()));
+    b.mask_start[k + 1] = b.masks.length;
+
+    parse_assert(this.next(), "round");
+    if (int(this.next()) != this.round) throw new Error("Wrong round number!");
+
+    // Total score.
+    parse_assert(this.next(), "total_score");
+    for (var i = 0; i < h.nb_players; ++i) b.score[k*h.nb_players + i] = int(this.next());
+
+    // Status.
+    parse_assert(this.next(), "status");
+    for (var i = 0; i < h.nb_players; ++i) b.cpu[k*h.nb_players + i] = int(double(this.next())*100);
+
+    // City owners.
+    parse_assert(this.next(), "city_owners");
+    for (var i = 0; i < h.nb_cities; ++i) b.city_owners[k*h.nb_cities + i] = int(this.next());
+
+    // Path owners.
+    parse_assert(this.next(), "path_owners");
+    for (var i = 0; i < h.nb_paths; ++i) b.path_owners[k*h.nb_paths + i] = int(this.next());
+
+    // Units.
+    parse_assert(this.next(), "units");
+    var u = k*h.total_units*UNIT_FIELDS;
+    for (var i = 0; i < h.total_units*UNIT_FIELDS; ++i) b.units[u + i] = int(this.next());
+
+    // Movements.
+    var m = k*h.total_units;
+    for (var i = 0; i < h.total_units; ++i) b.moves[m + i] = 0;
+    if (this.round != h.nb_rounds) {
+        parse_assert(this.next(), "commands");
+        var code = int(this.next());
+        while (code != -1) {
+            b.moves[m + code] = this.next().charCodeAt(0);
+            code = int(this.next());
+        }
+    }
+
+    ++b.count;
+    ++this.round;
+    if (b.count == PARSE_BATCH) this.flush();
+}
+
+
+// Posts the rounds parsed so far.
+ReplayParser.prototype.flush = function () {
+    var b = this.batch;
+    if (b == null || b.count == 0) return;
+    this.batch = null;
+    b.masks = new Int16Array(b.masks);
+    this.post(b, [b.cells.buffer, b.units.buffer, b.moves.buffer, b.score.buffer, b.cpu.buffer,
+                  b.city_owners.buffer, b.path_owners.buffer, b.mask_start.buffer, b.masks.buffer]);
+}
+
+
+// Parses text in the page, one chunk at a time to keep it responsive.
+function parseInSlices (parser, text, from) {
+    var to = Math.min(text.length, from + PARSE_CHUNK);
+    try {
+        parser.push(text.substring(from, to), to == text.length);
+    }
+    catch (e) {
+        parser.post({ type: "error", message: e.message, binary: e.binary }, []);
+        return;
+    }
+    if (to < text.length) setTimeout(function () { parseInSlices(parser, text, to); }, 0);
+}
+
+
+// *********************************************************************
+// Web Worker: receives a File or an URL, and posts the messages of the
+// parser as the game is read.
+// *********************************************************************
+
+if (typeof importScripts === "function") {
+    onmessage = function (evt) {
+        var source = evt.data;
+        var parser = new ReplayParser(function (msg, transfer) { postMessage(msg, transfer); });
+        var fail = function (e) { postMessage({ type: "error", message: e.message, binary: e.binary }); };
+
+        if (typeof source == "string") {
+            // Rounds are parsed while the rest of the game is downloaded.
+            var xmlhttp = new XMLHttpRequest();
+            var read = 0;
+            xmlhttp.onreadystatechange = function () {
+                if (xmlhttp.readyState < 3) return;
+                var text = xmlhttp.responseText;
+                var last = (xmlhttp.readyState == 4);
+                if (text.length == read && !last) return;
+                try {
+                    parser.push(text.substring(read), last);
+                    read = text.length;
+                }
+                catch (e) {
+                    xmlhttp.onreadystatechange = null;
+                    xmlhttp.abort();
+                    fail(e);
+                }
+            }
+            xmlhttp.open("GET", source, true);
+            xmlhttp.send();
+        }
+        else {
+            try {
+                var reader = new FileReaderSync();
+                var from = 0;
+                do {
+                    var to = Math.min(source.size, from + PARSE_CHUNK);
+                    parser.push(reader.readAsText(source.slice(from, to)), to == source.size);
+                    from = to;
+                } while (from < source.size);
+            }
+            catch (e) {
+                fail(e);
+            }
+        }
+    }
+}
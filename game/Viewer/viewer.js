@@ -12,9 +12,7 @@ var actRound = 0; // Current round index.
 
 
 // Data.
-var raw_data_str; // String for storing the raw data.
-var dataLoaded = false; // Set to true when raw_data_str is ready to be parsed.
-var data = { } // Object for storing all the game data.
+var data = { } // Object for storing all the game data (see onParsed).
 
 
 // Animation.
@@ -23,6 +21,17 @@ var FRAMES_PER_ROUND = 2;
 var frames = 0; // Incremented each tick, when it reaches FRAMES_PER_ROUND, actRound is updated (acording to gameDirection).
 
 
+// Layers: the board (cells and owners, redrawn only where they change),
+// the terrain without virus (offscreen), and masks and units (on top).
+var canvas, context;
+var unitCanvas, unitContext;
+var terrainCanvas, terrainContext;
+var drawnCells;  // Char of every cell on the board layer, 0 if not drawn.
+var drawnOwners; // Owner of every cell on the board layer, -1 if none.
+var cellOwners;  // Owners of the cells in the round being drawn.
+var unitRects = []; // Rectangles drawn on the unit layer.
+
+
 // Visuals.
 var unitSize = 0.85; // 1 = same size as tile.
 var unitLineWidth = 2;
@@ -66,6 +75,11 @@ var cell_colors = {
 }
 
 
+// Colors indexed by the char codes of the cells.
+var cell_code_colors = [];
+for (var c in cell_colors) cell_code_colors[c.charCodeAt(0)] = cell_colors[c];
+
+
 var player_colors = {
     0: "#FF0000",  // Red.
     1: "#FFCC00",  // Golden.
@@ -75,6 +89,16 @@ var player_colors = {
 }
 
 
+// Color of a player. Beyond the four above, hues are spread by the
+// golden angle, so that players with close numbers look different.
+function player_color (pl) {
+    if (pl in player_colors) return player_colors[pl];
+    var hue = Math.round((pl * 137.508) % 360);
+    var light = 40 + 15 * (pl % 3);
+    return "hsl(" + hue + ", 75%, " + light + "%)";
+}
+
+
 // *********************************************************************
 // Utility functions
 // *********************************************************************
@@ -110,217 +134,175 @@ function loadFile (file, callback) {
 }
 
 
-function int (s) {
-    return parseInt(s);
-}
-
-
-function double (s) {
-    return parseFloat(s);
-}
-
-
-function parse_assert (read_value, expected_value) {
-    var correct = (read_value == expected_value);
-    if (!correct) alert("Error parsing file, expected token: " + expected_value + ", read token: " + read_value + ".");
-    return correct;
-}
-
-
 // *********************************************************************
-// Initialization functions
+// Loading functions
 // *********************************************************************
 
-function parseData (raw_data_str) {
-    if (raw_data_str == "") {
-        alert("Could not load game file.");
-        return false;
+// Reads the game in source, a File or an URL, with the parser in a Web
+// Worker if possible. Rounds are stored as they arrive (see onParsed).
+function loadGame (source) {
+    data.source = source;
+    var worker = null;
+    try {
+        worker = new Worker("parser.js");
     }
-
-    // Convert text to tokens.
-    var st = raw_data_str + "";
-    var t = st.replace('\n', ' ').split(/\s+/);
-    var p = 0;
-
-    data.secgame = (t[p++] == "SecGame");
-
-    parse_assert(t[p++], "Seed");
-    data.seed = int(t[p++]);
-
-    // Game and version.
-    if (t[p++] != "Pandemic") {
-        alert("Are you sure this is a Pandemic game file?");
-        document.getElementById('file').value = "";
-        document.getElementById('inputdiv').style.display = "";
-        document.getElementById('loadingdiv').style.display = "none";
-        return false;
+    catch (e) {
+        worker = null; // E.g., pages opened from file:// in some browsers.
     }
 
-    data.version = t[p++];
-    if (data.version != "1.0") alert("Unsupported game version! Trying to load it anyway.");
-
-    parse_assert(t[p++], "nb_players");
-    data.nb_players = int(t[p++]);
-
-    parse_assert(t[p++], "rows");
-    data.rows = int(t[p++]);
-
-    parse_assert(t[p++], "cols");
-    data.cols = int(t[p++]);
-
-    parse_assert(t[p++], "nb_rounds");
-    data.nb_rounds = int(t[p++]);
-
-    parse_assert(t[p++], "initial_health");
-    data.initial_health = int(t[p++]);
-
-    parse_assert(t[p++], "nb_units");
-    data.nb_units = int(t[p++]);
-
-    parse_assert(t[p++], "bonus_per_city_cell");
-    data.bonus_per_city_cell = int(t[p++]);
-
-    parse_assert(t[p++], "bonus_per_path_cell");
-    data.bonus_per_path_cell = int(t[p++]);
-
-    parse_assert(t[p++], "factor_connected_component");
-    data.factor_connected_component = int(t[p++]);
-    
-    parse_assert(t[p++], "infection_factor");
-    data.infection_factor = int(t[p++]);
-    
-    parse_assert(t[p++], "mask_protection");
-    data.mask_protection = int(t[p++]);
-
-    data.total_units = data.nb_players * data.nb_units;
-
-    parse_assert(t[p++], "names");
-    data.names = new Array();
-    for (var i = 0; i < data.nb_players; ++i) data.names[i] = t[p++];
+    if (worker == null) {
+        parseInPage(source);
+        return;
+    }
+    worker.onmessage = function (evt) { onParsed(evt.data); };
+    worker.onerror = function (evt) {
+        evt.preventDefault();
+        worker.terminate();
+        if (data.nb_rounds === undefined) parseInPage(source);
+        else onParsed({ type: "error", message: evt.message });
+    };
+    worker.postMessage(source);
+}
 
-    data.rounds = new Array();
-    for (var round = 0; round <= data.nb_rounds; ++round) {
 
-        // Maze.
-        t[p++]; // 1st row of column labels.
-        t[p++]; // 2nd row of column labels.
+function parseInPage (source) {
+    var parser = new ReplayParser(function (msg, transfer) { onParsed(msg); });
+    if (typeof source == "string") loadFile(source, function (text) { parseInSlices(parser, text, 0); });
+    else {
+        var reader = new FileReader();
+        reader.readAsText(source);
+        reader.onloadend = function (evt) {
+            if (evt.target.readyState != FileReader.DONE) alert("Error accessing file.");
+            else parseInSlices(parser, reader.result, 0);
+        };
+    }
+}
 
-        data.rounds[round] = new Object();
-        data.rounds[round].rows = new Array();
-        for (var i = 0; i < data.rows; ++i) {
-            parse_assert(t[p++], i);
-            data.rounds[round].rows[i] = t[p++];
-        }
 
-        // Cities.
-        parse_assert(t[p++], "cities");
-        data.rounds[round].nb_cities = int(t[p++]);
-        data.rounds[round].cities = new Array();
-        for (var i = 0; i < data.rounds[round].nb_cities; ++i) {
-            data.rounds[round].cities[i] = new Object();
-            data.rounds[round].cities[i].size = int(t[p++]);
-            data.rounds[round].cities[i].cell = new Array();
-            for (var j = 0; j < data.rounds[round].cities[i].size; ++j) {
-                data.rounds[round].cities[i].cell[j] = new Object();
-                data.rounds[round].cities[i].cell[j].i = int(t[p++]);
-                data.rounds[round].cities[i].cell[j].j = int(t[p++]);
-            }
+// Handles the messages of the parser (see ReplayParser).
+function onParsed (msg) {
+    if (msg.type == "header") {
+        for (var key in msg.header) data[key] = msg.header[key];
+        if (data.version != "1.0") alert("Unsupported game version! Trying to load it anyway.");
+        if (data.format > 2) alert("Unsupported format! Trying to load it anyway.");
+
+        // Every round is stored in typed arrays, indexed by round.
+        var n = data.nb_rounds + 1;
+        data.cells       = new Uint8Array(n*data.rows*data.cols);
+        data.units       = new Int32Array(n*data.total_units*UNIT_FIELDS);
+        data.moves       = new Uint8Array(n*data.total_units);
+        data.score       = new Int32Array(n*data.nb_players);
+        data.cpu         = new Int16Array(n*data.nb_players);
+        data.city_owners = new Int8Array(n*data.nb_cities);
+        data.path_owners = new Int8Array(n*data.nb_paths);
+        data.masks       = new Array(n);
+        data.loaded      = 0; // Number of rounds available.
+        data.complete    = false;
+    }
+    else if (msg.type == "rounds") {
+        var r = msg.first;
+        var n = msg.count;
+        var rc = data.rows*data.cols;
+        data.cells.set(msg.cells.subarray(0, n*rc), r*rc);
+        data.units.set(msg.units.subarray(0, n*data.total_units*UNIT_FIELDS), r*data.total_units*UNIT_FIELDS);
+        data.moves.set(msg.moves.subarray(0, n*data.total_units), r*data.total_units);
+        data.score.set(msg.score.subarray(0, n*data.nb_players), r*data.nb_players);
+        data.cpu.set(msg.cpu.subarray(0, n*data.nb_players), r*data.nb_players);
+        data.city_owners.set(msg.city_owners.subarray(0, n*data.nb_cities), r*data.nb_cities);
+        data.path_owners.set(msg.path_owners.subarray(0, n*data.nb_paths), r*data.nb_paths);
+        for (var k = 0; k < n; ++k) data.masks[r + k] = msg.masks.subarray(msg.mask_start[k], msg.mask_start[k + 1]);
+
+        var first = (data.loaded == 0);
+        data.loaded = r + n;
+        if (first) {
+            data.terrain = new Uint8Array(rc);
+            for (var k = 0; k < rc; ++k) data.terrain[k] = terrainChar(data.cells[k]);
+            initGame();
         }
-
-        // Paths.
-        parse_assert(t[p++], "paths");
-        data.rounds[round].nb_paths = int(t[p++]);
-        data.rounds[round].paths = new Array();
-        for (var i = 0; i < data.rounds[round].nb_paths; ++i) {
-            data.rounds[round].paths[i] = new Object();
-            data.rounds[round].paths[i].a    = int(t[p++]);
-            data.rounds[round].paths[i].b    = int(t[p++]);
-            data.rounds[round].paths[i].size = int(t[p++]);
-            data.rounds[round].paths[i].cell = new Array();
-            for (var j = 0; j < data.rounds[round].paths[i].size; ++j) {
-                data.rounds[round].paths[i].cell[j] = new Object();
-                data.rounds[round].paths[i].cell[j].i = int(t[p++]);
-                data.rounds[round].paths[i].cell[j].j = int(t[p++]);
-            }
+    }
+    else if (msg.type == "done") data.complete = true;
+    else if (msg.type == "error") {
+        if (msg.binary) {
+            loadBinary(data.source);
+            return;
         }
-        
-        // Masks.
-        parse_assert(t[p++], "masks");
-        data.rounds[round].nb_masks = int(t[p++]);
-        data.rounds[round].masks = new Array();
-        for (var i = 0; i < data.rounds[round].nb_masks; ++i) {
-			data.rounds[round].masks[i] = new Object();
-			data.rounds[round].masks[i].a = int(t[p++]);
-			data.rounds[round].masks[i].b = int(t[p++]);
-		}
-        
-        
-        parse_assert(t[p++], "round");
-        if (int(t[p++]) != round) alert("Wrong round number!");
-
-        // Total score.
-        parse_assert(t[p++], "total_score");
-        data.rounds[round].total_score = new Array();
-        for (var i = 0; i < data.nb_players; ++i) data.rounds[round].total_score[i] = int(t[p++]);
-
-        // Status.
-        parse_assert(t[p++], "status");
-        data.rounds[round].cpu = new Array();
-        for (var i = 0; i < data.nb_players; ++i) {
-            var cpu = int(double(t[p++])*100);
-            data.rounds[round].cpu[i] = (cpu == -100) ? "out" : cpu + "%";
+        alert(msg.message);
+        if (data.loaded === undefined || data.loaded == 0) {
+            document.getElementById('file').value = "";
+            document.getElementById('inputdiv').style.display = "";
+            document.getElementById('loadingdiv').style.display = "none";
         }
+        else data.complete = true; // Play what could be read.
+    }
+}
 
-        // City owners.
-        parse_assert(t[p++], "city_owners");
-        data.rounds[round].city_owners = new Array();
-        for (var i = 0; i < data.rounds[round].nb_cities; ++i) {
-            data.rounds[round].city_owners[i] = int(t[p++]);
-        }
 
-        // Path owners.
-        parse_assert(t[p++], "path_owners");
-        data.rounds[round].path_owners = new Array();
-        for (var i = 0; i < data.rounds[round].nb_paths; ++i) {
-            data.rounds[round].path_owners[i] = int(t[p++]);
+// Reads a game in the binary replay format. Rounds are rebuilt when
+// they are shown (see BinaryReplay).
+function loadBinary (source) {
+    var start = function (buffer) {
+        try {
+            data.replay = new BinaryReplay(buffer);
         }
-
-        // Units.
-        parse_assert(t[p++], "units");
-        data.rounds[round].units = new Array();
-        for (var i = 0; i < data.total_units; ++i) {
-            data.rounds[round].units[i] = new Object();
-            data.rounds[round].units[i].player = int(t[p++]);
-            data.rounds[round].units[i].i      = int(t[p++]);
-            data.rounds[round].units[i].j      = int(t[p++]);
-            data.rounds[round].units[i].health = int(t[p++]);
-	    data.rounds[round].units[i].damage = int(t[p++]);
-	    data.rounds[round].units[i].turns = int(t[p++]);
-	    data.rounds[round].units[i].imm = int(t[p++]);
-	    data.rounds[round].units[i].mask = int(t[p++]);
+        catch (e) {
+            onParsed({ type: "error", message: e.message });
+            return;
         }
-       
-
-        if (round != data.nb_rounds) {
-            // Movements.
-            parse_assert(t[p++], "commands");
-            var code = int(t[p++]);
-            while (code != -1) {
-                data.rounds[round].units[code].move = t[p++];
-                code = int(t[p++]);
-            }
+        for (var key in data.replay.header) data[key] = data.replay.header[key];
+        data.loaded   = data.nb_rounds + 1;
+        data.complete = true;
+        initGame();
+    };
+
+    if (typeof source == "string") {
+        var xmlhttp = new XMLHttpRequest();
+        xmlhttp.responseType = "arraybuffer";
+        xmlhttp.onreadystatechange = function () {
+            if (xmlhttp.readyState == 4) start(xmlhttp.response);
         }
+        xmlhttp.open("GET", source, true);
+        xmlhttp.send();
+    }
+    else {
+        var reader = new FileReader();
+        reader.readAsArrayBuffer(source);
+        reader.onloadend = function (evt) {
+            if (evt.target.readyState != FileReader.DONE) alert("Error accessing file.");
+            else start(reader.result);
+        };
     }
-    return true;
 }
 
 
-// Initializing the game.
-function initGame (raw_data) {
-    document.getElementById("loadingdiv").style.display = "";
+// Last round that can be shown.
+function lastRound () {
+    return data.loaded - 1;
+}
+
+
+// State after round r: typed arrays with the layout of the messages of
+// the parser, for a single round. Valid until the next call.
+function roundData (r) {
+    if (data.replay) return data.replay.frame(r);
+
+    var rc = data.rows*data.cols;
+    var tu = data.total_units;
+    var np = data.nb_players;
+    return {
+        cells:       data.cells.subarray(r*rc, (r + 1)*rc),
+        units:       data.units.subarray(r*tu*UNIT_FIELDS, (r + 1)*tu*UNIT_FIELDS),
+        moves:       data.moves.subarray(r*tu, (r + 1)*tu),
+        score:       data.score.subarray(r*np, (r + 1)*np),
+        cpu:         data.cpu.subarray(r*np, (r + 1)*np),
+        city_owners: data.city_owners.subarray(r*data.nb_cities, (r + 1)*data.nb_cities),
+        path_owners: data.path_owners.subarray(r*data.nb_paths, (r + 1)*data.nb_paths),
+        masks:       data.masks[r]
+    };
+}
 
-    // TODO: Next two calls could run concurrently.
-    if (parseData(raw_data) === false) return;
+
+// Initializing the game, when its first rounds are available.
+function initGame () {
     preloadImages();
 
     // Prepare state variables.
@@ -333,6 +315,13 @@ function initGame (raw_data) {
     // Canvas element.
     canvas = document.getElementById('myCanvas');
     context = canvas.getContext("2d");
+    unitCanvas = document.getElementById('unitCanvas');
+    unitContext = unitCanvas.getContext("2d");
+    terrainCanvas = document.createElement('canvas');
+    terrainContext = terrainCanvas.getContext("2d");
+    drawnCells  = new Uint8Array(data.rows*data.cols);
+    drawnOwners = new Int8Array(data.rows*data.cols);
+    cellOwners  = new Int8Array(data.rows*data.cols);
 
     // Prepare the slider.
     $("#slider").slider({
@@ -411,114 +400,83 @@ function writeGameState () {
     $("#round").html("Round: " + actRound);
 
     // Update scoreboard.
+    var g = roundData(actRound);
     var scoreboard = "";
     for (var i = 0; i < data.nb_players; ++i) {
         scoreboard += "<span class='score'>"
-            + "<div style='display:inline-block; margin-top: 5px; width:20px; height:20px; background-color:" + player_colors[i] + "'></div>"
+            + "<div style='display:inline-block; margin-top: 5px; width:20px; height:20px; background-color:" + player_color(i) + "'></div>"
             + "<div style='display:inline-block; vertical-align: middle; margin-bottom: 7px; margin-left:8px;'>" + data.names[i] + "</div>"
             + "<br/>"
             + "<div style='margin-left: 10px;'>"
             // + "<div style='padding:2px;'>Land: " + data.rounds[actRound].land[i] + "</div>"
-            + (data.secgame ? "<div style='padding:2px;'>CPU: " + data.rounds[actRound].cpu[i] + "</div>" : "")
+            + (data.secgame ? "<div style='padding:2px;'>CPU: " + cpuText(g.cpu[i]) + "</div>" : "")
             + "</div>"
             + "</span><br/><br/>";
     }
     $("#scores").html(scoreboard);
 
-    var order = [0, 1, 2, 3];
-    for (var i = 0; i < 3; ++i) {
-        for (var j = i + 1; j < 4; ++j) {
-            if (data.rounds[actRound].total_score[order[i]] < data.rounds[actRound].total_score[order[j]]) {
-                var k = order[i];
-                order[i] = order[j];
-                order[j] = k;
-            }
-        }
-    }
+    var score = g.score;
+    // Players by decreasing total score, ties by id.
+    var order = [];
+    for (var pl = 0; pl < data.nb_players; ++pl) order.push(pl);
+    order.sort(function (a, b) { return score[b] - score[a] || a - b; });
 
     var totalboard = "";
     for (var i = 0; i < data.nb_players; ++i) {
         totalboard += "<span class='total'>"
-            + "<div style='display:inline-block; margin-top: 5px; width:20px; height:20px; background-color:" + player_colors[order[i]] + "'></div>"
+            + "<div style='display:inline-block; margin-top: 5px; width:20px; height:20px; background-color:" + player_color(order[i]) + "'></div>"
             + "<div style='display:inline-block; vertical-align: middle; margin-bottom: 7px; margin-left:8px;'>"
-            + data.rounds[actRound].total_score[order[i]] + "</div>"
+            + score[order[i]] + "</div>"
             + "</span><br/><br/>";
     }
     $("#totals").html(totalboard);
 }
 
 
+function cpuText (cpu) {
+    return (cpu == -100) ? "out" : cpu + "%";
+}
+
+
 function drawGame () {
     // Boundary check.
     if (actRound < 0) actRound = 0;
-    if (actRound >= data.nb_rounds) actRound = data.nb_rounds;
-
-    // Outter Rectangle.
-    // Uncommented so as not to draw the grid.
-    // context.fillStyle = grid_color;
-    // context.fillRect(0, 0, tileSize*data.cols, tileSize*data.rows);
+    if (actRound >= lastRound()) actRound = lastRound();
 
-    // Draw maze.
-    var rows = data.rounds[actRound].rows;
-    for (var i = 0; i < data.rows; ++i) {
-        var row = rows[i];
-        for (var j = 0; j < data.cols; ++j) {
-            var cell = row[j];
-            context.fillStyle = cell_colors[cell];
-            context.fillRect(j*tileSize, i*tileSize, tileSize, tileSize); // -1 to show a grid.
-        }
-    }
+    var g = roundData(actRound);
+    drawBoard(g);
 
-    // Draw cities.
-    for (var i = 0; i < data.rounds[actRound].nb_cities; ++i) {
-        var city  = data.rounds[actRound].cities[i];
-        var owner = data.rounds[actRound].city_owners[i];
-        if (owner != -1) {
-            context.strokeStyle = player_colors[owner];
-            context.fillStyle   = player_colors[owner];
-            for (var j = 0; j < city.size; ++j) {
-                drawCross(city.cell[j].i, city.cell[j].j);
-            }
-        }
+    // Clear masks and units of the previous frame.
+    for (var k = 0; k < unitRects.length; ++k) {
+        var r = unitRects[k];
+        unitContext.clearRect(r[0], r[1], r[2], r[3]);
     }
+    unitRects = [];
 
-    // Draw paths.
-    for (var i = 0; i < data.rounds[actRound].nb_paths; ++i) {
-        var path  = data.rounds[actRound].paths[i];
-        var owner = data.rounds[actRound].path_owners[i];
-        if (owner != -1) {
-            context.strokeStyle = player_colors[owner];
-            context.fillStyle   = player_colors[owner];
-            for (var j = 0; j < path.size; ++j) {
-                drawCross(path.cell[j].i, path.cell[j].j);
-            }
-        }
-    }
-    
     // Draw masks.
-    for (var i = 0; i < data.rounds[actRound].nb_masks; ++i) {
-		var mask = data.rounds[actRound].masks[i];
-		context.strokeStyle = mask_color;
-		context.fillStyle   = mask_color;
-		drawCircle(mask.a, mask.b);
-	}
+    var masks = g.masks;
+    unitContext.lineWidth   = 1;
+    unitContext.strokeStyle = mask_color;
+    unitContext.fillStyle   = mask_color;
+    for (var k = 0; k < masks.length; k += 2) drawCircle(masks[k], masks[k + 1]);
     
     // Draw units.
-    context.lineWidth = unitLineWidth;
-    var units = data.rounds[actRound].units;
-    for (var un in units) {
-        var u = units[un];
-        context.strokeStyle = player_colors[u.player];
-        context.fillStyle = player_colors[u.player];
-        var i = u.i;
-        var j = u.j;
+    unitContext.lineWidth = unitLineWidth;
+    for (var id = 0; id < data.total_units; ++id) {
+        var u = id*UNIT_FIELDS;
+        var player = g.units[u + UNIT_PLAYER];
+        unitContext.strokeStyle = player_color(player);
+        unitContext.fillStyle = player_color(player);
+        var i = g.units[u + UNIT_I];
+        var j = g.units[u + UNIT_J];
 
         if (gameAnim) {
             if (frames >= FRAMES_PER_ROUND/2) {
-                if (u.move == 'b') i += 0.5;
-                else if (u.move == 'r') j += 0.5;
-                else if (u.move == 't') i -= 0.5;
-                else if (u.move == 'l') j -= 0.5;
+                var move = String.fromCharCode(g.moves[id]);
+                if (move == 'b') i += 0.5;
+                else if (move == 'r') j += 0.5;
+                else if (move == 't') i -= 0.5;
+                else if (move == 'l') j -= 0.5;
             }
         }
         drawSquare(i, j);
@@ -526,19 +484,97 @@ function drawGame () {
 }
 
 
+// Redraws the cells of the board layer whose virus or owner changed,
+// given the state g of the current round.
+function drawBoard (g) {
+    cellOwners.fill(-1);
+    for (var i = 0; i < data.nb_cities; ++i) {
+        var city  = data.cities[i];
+        var owner = g.city_owners[i];
+        for (var j = 0; j < city.size; ++j) cellOwners[city.cell[j].i*data.cols + city.cell[j].j] = owner;
+    }
+    for (var i = 0; i < data.nb_paths; ++i) {
+        var path  = data.paths[i];
+        var owner = g.path_owners[i];
+        for (var j = 0; j < path.size; ++j) cellOwners[path.cell[j].i*data.cols + path.cell[j].j] = owner;
+    }
+
+    var cells = g.cells;
+    for (var k = 0; k < cells.length; ++k) {
+        if (cells[k] != drawnCells[k] || cellOwners[k] != drawnOwners[k]) {
+            drawCell(Math.floor(k/data.cols), k%data.cols, cells[k], cellOwners[k]);
+            drawnCells[k]  = cells[k];
+            drawnOwners[k] = cellOwners[k];
+        }
+    }
+}
+
+
+// Pixel rectangle of the cell (i, j), on integer coordinates so that
+// redrawing a cell does not blend with its neighbours.
+function cellRect (i, j) {
+    var x = Math.floor(j*tileSize);
+    var y = Math.floor(i*tileSize);
+    return [x, y, Math.floor((j + 1)*tileSize) - x, Math.floor((i + 1)*tileSize) - y];
+}
+
+
+function drawCell (i, j, cell, owner) {
+    var r = cellRect(i, j);
+    if (cell == terrainChar(cell)) context.drawImage(terrainCanvas, r[0], r[1], r[2], r[3], r[0], r[1], r[2], r[3]);
+    else {
+        context.fillStyle = cell_code_colors[cell];
+        context.fillRect(r[0], r[1], r[2], r[3]);
+    }
+    if (owner != -1) {
+        context.strokeStyle = player_color(owner);
+        context.fillStyle   = player_color(owner);
+        drawCross(i, j);
+    }
+}
+
+
+// Char code of the cell without virus.
+function terrainChar (cell) {
+    if (cell >= 97 && cell <= 100) return 46; // 'a'..'d': '.'
+    if (cell >= 48 && cell <=  57) return 44; // '0'..'9': ','
+    if (cell >= 65 && cell <=  74) return 59; // 'A'..'J': ';'
+    return cell;
+}
+
+
+// Draws the terrain layer, and forces to redraw the whole board.
+function drawTerrain () {
+    terrainCanvas.width  = canvas.width;
+    terrainCanvas.height = canvas.height;
+    for (var i = 0; i < data.rows; ++i) {
+        for (var j = 0; j < data.cols; ++j) {
+            var r = cellRect(i, j);
+            terrainContext.fillStyle = cell_code_colors[data.terrain[i*data.cols + j]];
+            terrainContext.fillRect(r[0], r[1], r[2], r[3]);
+        }
+    }
+    drawnCells.fill(0);
+    drawnOwners.fill(-1);
+    unitRects = [];
+}
+
+
 function drawSquare (i, j) {
     var size = unitSize * tileSize;
     var offset = (tileSize - size) / 2;
-    context.fillRect(j*tileSize + offset, i*tileSize + offset, size, size);
+    unitContext.fillRect(j*tileSize + offset, i*tileSize + offset, size, size);
+    unitRects.push([Math.floor(j*tileSize) - 1, Math.floor(i*tileSize) - 1, Math.ceil(tileSize) + 2, Math.ceil(tileSize) + 2]);
 }
 
 function drawCircle(i, j) {
     var size = unitSize * tileSize * 0.6;
     var offset = (tileSize - size) / 2;
-    context.beginPath();
-    context.arc(j*tileSize + size/2 + offset, i*tileSize + size/2 + offset, size/3, 0, Math.PI*2, false);
-    context.fill();
-    context.stroke();
+    unitContext.beginPath();
+    unitContext.arc(j*tileSize + size/2 + offset, i*tileSize + size/2 + offset, size/3, 0, Math.PI*2, false);
+    unitContext.fill();
+    unitContext.stroke();
+    unitRects.push([Math.floor(j*tileSize) - 1, Math.floor(i*tileSize) - 1, Math.ceil(tileSize) + 2, Math.ceil(tileSize) + 2]);
 }
 
 function drawCross (i, j) {
@@ -685,10 +721,14 @@ function onWindowResize (event) {
 
     canvas.width  = size;
     canvas.height = size;
+    unitCanvas.width  = size;
+    unitCanvas.height = size;
 
     var max_dimension = Math.max(data.cols,data.rows);
     tileSize = size / max_dimension;
 
+    drawTerrain();
+
     drawGame();
 }
 
@@ -718,9 +758,10 @@ function mainloop () {
 
     if (actRound < 0) actRound = 0;
 
-    if (actRound > data.nb_rounds) {
-        actRound = data.nb_rounds;
-        gamePaused = true;
+    // While the game is being read, playback waits at the last round read.
+    if (actRound > lastRound()) {
+        actRound = lastRound();
+        if (data.complete) gamePaused = true;
         frames = 0;
     }
 
@@ -770,22 +811,14 @@ function init () {
         inputdiv.style.display = "";
         document.getElementById('file').addEventListener('change', function(evt) {
             //http://www.html5rocks.com/en/tutorials/file/dndfiles/
-            var file = evt.target.files[0];
-            var reader = new FileReader();
-            reader.readAsText(file);
-            reader.onloadend = function(evt) {
-                if (evt.target.readyState != FileReader.DONE) alert("Error accessing file.");
-                else { // DONE == 2.
-                    inputdiv.style.display = "none";
-                    document.getElementById("loadingdiv").style.display = "";
-                    initGame(reader.result);
-                }
-            };
+            inputdiv.style.display = "none";
+            document.getElementById("loadingdiv").style.display = "";
+            loadGame(evt.target.files[0]);
         }, false);
     }
     else {
         document.getElementById("loadingdiv").style.display = "";
         // Load the given game.
-        loadFile(game, initGame);
+        loadGame(game);
     }
 }
@@ -0,0 +1,189 @@
+#ifndef Writer_hh
+#define Writer_hh
+
+
+#include <cstdio>
+
+#include "Utils.hh"
+
+
+/*! \file
+ * Contains a buffered writer for the text output of the game.
+ */
+
+
+/**
+ * Accumulates text in a large buffer that is reused, and only hands it
+ * to the underlying stream when it is full or when flush() is called.
+ * Integers and chars are formatted by hand; the output is the same as
+ * with the operators << of ostream under the default flags.
+ */
+class Writer {
+
+public:
+
+  /**
+   * Constructor, given the stream where the text is finally written.
+   */
+  Writer (ostream& os, int capacity = 1 << 16);
+
+  /**
+   * Destructor, writes the pending text (without flushing the stream).
+   */
+  ~Writer ();
+
+  /**
+   * Writes the pending text to the stream and flushes the stream.
+   */
+  void flush ();
+
+  /**
+   * Returns the number of chars written so far, pending ones included.
+   */
+  long long offset () const;
+
+  Writer& operator<< (char c);
+  Writer& operator<< (const char* s);
+  Writer& operator<< (const string& s);
+  Writer& operator<< (bool b);
+  Writer& operator<< (int x);
+  Writer& operator<< (long x);
+  Writer& operator<< (long long x);
+  Writer& operator<< (unsigned x);
+  Writer& operator<< (unsigned long x);
+  Writer& operator<< (unsigned long long x);
+  Writer& operator<< (double x);
+
+
+  //////// STUDENTS DO NOT NEED TO READ BELOW THIS LINE ////////
+
+
+private:
+
+  ostream&       os_;
+  vector<char>  buf_;
+  int             n_; // Number of pending chars.
+  long long   drained_; // Number of chars handed to the stream.
+
+  /**
+   * Hands the pending text to the stream.
+   */
+  void drain ();
+
+  /**
+   * Makes sure that k more chars fit in the buffer.
+   */
+  inline void reserve (int k) {
+    if (n_ + k > int(buf_.size())) {
+      drain();
+      if (k > int(buf_.size())) buf_.resize(k);
+    }
+  }
+
+  void write (const char* s, int k);
+
+  void write_unsigned (unsigned long long x);
+
+};
+
+
+inline Writer::Writer (ostream& os, int capacity) :
+  os_(os), buf_(capacity), n_(0), drained_(0) { }
+
+inline Writer::~Writer () {
+  drain();
+}
+
+inline void Writer::drain () {
+  if (n_ > 0) os_.write(buf_.data(), n_);
+  drained_ += n_;
+  n_ = 0;
+}
+
+inline void Writer::flush () {
+  drain();
+  os_.flush();
+}
+
+inline long long Writer::offset () const {
+  return drained_ + n_;
+}
+
+inline void Writer::write (const char* s, int k) {
+  reserve(k);
+  memcpy(buf_.data() + n_, s, k);
+  n_ += k;
+}
+
+inline void Writer::write_unsigned (unsigned long long x) {
+  char tmp[20];
+  int k = 20;
+  do {
+    tmp[--k] = char('0' + x % 10);
+    x /= 10;
+  } while (x > 0);
+  write(tmp + k, 20 - k);
+}
+
+inline Writer& Writer::operator<< (char c) {
+  reserve(1);
+  buf_[n_++] = c;
+  return *this;
+}
+
+inline Writer& Writer::operator<< (const char* s) {
+  write(s, strlen(s));
+  return *this;
+}
+
+inline Writer& Writer::operator<< (const string& s) {
+  write(s.data(), s.size());
+  return *this;
+}
+
+inline Writer& Writer::operator<< (bool b) {
+  return *this << char('0' + b);
+}
+
+inline Writer& Writer::operator<< (int x) {
+  return *this << (long long)x;
+}
+
+inline Writer& Writer::operator<< (long x) {
+  return *this << (long long)x;
+}
+
+inline Writer& Writer::operator<< (long long x) {
+  if (x < 0) {
+    *this << '-';
+    write_unsigned(-(unsigned long long)x);
+  }
+  else write_unsigned(x);
+  return *this;
+}
+
+inline Writer& Writer::operator<< (unsigned x) {
+  write_unsigned(x);
+  return *this;
+}
+
+inline Writer& Writer::operator<< (unsigned long x) {
+  write_unsigned(x);
+  return *this;
+}
+
+inline Writer& Writer::operator<< (unsigned long long x) {
+  write_unsigned(x);
+  return *this;
+}
+
+inline Writer& Writer::operator<< (double x) {
+  // Same as the default format of ostream (%g with precision 6).
+  char tmp[32];
+  int k = snprintf(tmp, sizeof(tmp), "%g", x);
+  write(tmp, k);
+  return *this;
+}
+
+
+#endif